@@ -0,0 +1,123 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OPENLIBC_BLOOM_H
+#define OPENLIBC_BLOOM_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "openlibc/hash.h"
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/* A blocked Bloom filter.
+ *
+ * A Bloom filter answers approximate membership queries: bloom_may_contain()
+ * never returns false for a hash that was added, but it may return true for
+ * one that was not.  This filter splits its bits into 64-byte blocks, each of
+ * which fits in a single cache line.  Each added hash selects one block and
+ * sets one bit in each of the block's 8 words, so that a query touches only
+ * one cache line.
+ *
+ * The filter works on 32-bit hash values, such as those from hash_bytes() and
+ * hash_string(), rather than on keys themselves.  Elements cannot be removed,
+ * so a filter that tracks a changing set should be rebuilt from time to time,
+ * e.g. when bloom_is_full() becomes true.
+ *
+ * bloom_init() allows at least 16 bits per hash.  At that density the false
+ * positive rate is about 0.1%, falling to about 0.015% at half load. */
+struct bloom {
+    uint64_t *blocks;           /* BLOOM_BLOCK_WORDS * ('mask' + 1) words. */
+    size_t mask;                /* Number of blocks, minus 1. */
+    size_t n;                   /* Number of hashes added. */
+    size_t capacity;            /* Number of hashes the filter is sized for. */
+};
+
+/* Number of 64-bit words in a block. */
+#define BLOOM_BLOCK_WORDS 8
+
+void bloom_init(struct bloom *, size_t capacity);
+void bloom_destroy(struct bloom *);
+void bloom_clear(struct bloom *);
+
+static inline void bloom_add(struct bloom *, uint32_t hash);
+static inline bool bloom_may_contain(const struct bloom *, uint32_t hash);
+
+/* Returns true if more hashes have been added to 'bloom' than it was sized
+ * for, meaning that its false positive rate is higher than intended. */
+static inline bool
+bloom_is_full(const struct bloom *bloom)
+{
+    return bloom->n > bloom->capacity;
+}
+
+/* Implementation details. */
+
+/* Returns the first word of the block in 'bloom' that 'hash' selects, and
+ * stores in '*bitsp' the remixed hash used to choose bits within it. */
+static inline uint64_t *
+bloom_block__(const struct bloom *bloom, uint32_t hash, uint32_t *bitsp)
+{
+    *bitsp = mhash_finish(hash);
+    return &bloom->blocks[(hash & bloom->mask) * BLOOM_BLOCK_WORDS];
+}
+
+/* Returns the bit within word 'i' of a block that 'bits' selects. */
+static inline uint64_t
+bloom_bit__(uint32_t bits, int i)
+{
+    static const uint32_t salts[BLOOM_BLOCK_WORDS] = {
+        0x47b6137b, 0x44974d91, 0x8824ad5b, 0xa2b7289d,
+        0x705495c7, 0x2df1424b, 0x9efc4947, 0x5c6bfb31,
+    };
+    return UINT64_C(1) << ((bits * salts[i]) >> 26);
+}
+
+/* Adds 'hash' to 'bloom'. */
+static inline void
+bloom_add(struct bloom *bloom, uint32_t hash)
+{
+    uint32_t bits;
+    uint64_t *block = bloom_block__(bloom, hash, &bits);
+
+    for (int i = 0; i < BLOOM_BLOCK_WORDS; i++) {
+        block[i] |= bloom_bit__(bits, i);
+    }
+    bloom->n++;
+}
+
+/* Returns false if 'hash' was definitely never added to 'bloom', true if it
+ * might have been. */
+static inline bool
+bloom_may_contain(const struct bloom *bloom, uint32_t hash)
+{
+    uint32_t bits;
+    const uint64_t *block = bloom_block__(bloom, hash, &bits);
+    uint64_t missing = 0;
+
+    for (int i = 0; i < BLOOM_BLOCK_WORDS; i++) {
+        missing |= bloom_bit__(bits, i) & ~block[i];
+    }
+    return !missing;
+}
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /* bloom.h */
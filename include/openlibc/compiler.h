@@ -28,11 +28,13 @@
 #endif
 
 #if __GNUC__ && !__CHECKER__
+#define NO_RETURN __attribute__((__noreturn__))
 #define STRFTIME_FORMAT(FMT) __attribute__((__format__(__strftime__, FMT, 0)))
 #define MALLOC_LIKE __attribute__((__malloc__))
 #define ALWAYS_INLINE __attribute__((always_inline))
 #define SENTINEL(N) __attribute__((sentinel(N)))
 #else
+#define NO_RETURN
 #define STRFTIME_FORMAT(FMT)
 #define MALLOC_LIKE
 #define ALWAYS_INLINE
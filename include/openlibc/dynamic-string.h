@@ -35,16 +35,33 @@ extern "C" {
  * The 'string' member does not always point to a null-terminated string.
  * Initially it is NULL, and even when it is nonnull, some operations do not
  * ensure that it is null-terminated.  Use ds_cstr() to ensure that memory is
- * allocated for the string and that it is null-terminated. */
+ * allocated for the string and that it is null-terminated.
+ *
+ * A ds may start out using a "stub", a buffer supplied by the caller (often
+ * on the stack), instead of heap memory.  This avoids allocating memory at all
+ * for strings that fit in the stub.  A ds copies its content to the heap if it
+ * grows beyond its stub.  The stub must remain valid until the ds is
+ * destroyed, but otherwise a ds with a stub may be used like any other:
+ *
+ *     char buf[64];
+ *     struct ds s;
+ *
+ *     ds_init_stub(&s, buf, sizeof buf);
+ *     ds_put_format(&s, ...);
+ *     ...
+ *     ds_destroy(&s);
+ */
 typedef struct ds {
     char *string;       /* Null-terminated string. */
     size_t length;      /* Bytes used, not including null terminator. */
     size_t allocated;   /* Bytes allocated, not including null terminator. */
+    char *stub;         /* Caller-supplied initial buffer, or NULL. */
 } ds_t;
 
-#define DS_EMPTY_INITIALIZER { NULL, 0, 0 }
+#define DS_EMPTY_INITIALIZER { NULL, 0, 0, NULL }
 
 void ds_init(ds_t *);
+void ds_init_stub(ds_t *, char *stub, size_t stub_size);
 void ds_clear(ds_t *);
 void ds_truncate(ds_t *, size_t new_length);
 void ds_reserve(ds_t *, size_t min_length);
@@ -55,11 +72,26 @@ void ds_put_char_multiple(ds_t *, char, size_t n);
 void ds_put_buffer(ds_t *, const char *, size_t n);
 void ds_put_cstr(ds_t *, const char *);
 void ds_put_and_free_cstr(ds_t *, char *);
+void ds_put_u64(ds_t *, uint64_t);
+void ds_put_i64(ds_t *, int64_t);
+void ds_put_u64_hex(ds_t *, uint64_t, bool upper);
+void ds_put_double(ds_t *, double);
 void ds_put_format(ds_t *, const char *, ...) OLC_PRINTF_FORMAT(2, 3);
 void ds_put_format_valist(ds_t *, const char *, va_list)
     OLC_PRINTF_FORMAT(2, 0);
+
+struct ds_format *ds_format_compile(const char *format);
+void ds_format_destroy(struct ds_format *);
+void ds_put_compiled(ds_t *, const struct ds_format *, ...);
+void ds_put_compiled_valist(ds_t *, const struct ds_format *, va_list);
+
 void ds_put_printable(ds_t *, const char *, size_t);
+void ds_put_json_string(ds_t *, const char *, size_t);
 void ds_put_hex(ds_t *ds, const void *buf, size_t size);
+void ds_put_hex_string(ds_t *ds, const void *buf, size_t size);
+int ds_put_hex_decode(ds_t *ds, const char *hex, size_t n);
+void ds_put_base64(ds_t *, const void *, size_t n, bool url);
+int ds_put_base64_decode(ds_t *, const char *, size_t n, bool url);
 void ds_put_hex_dump(ds_t *ds, const void *buf_, size_t size,
                      uintptr_t ofs, bool ascii);
 int ds_get_line(ds_t *, FILE *);
@@ -0,0 +1,134 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OPENLIBC_FROZEN_H
+#define OPENLIBC_FROZEN_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "openlibc/smap.h"
+#include "openlibc/sset.h"
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/* Frozen string sets and maps.
+ *
+ * sset_freeze() and smap_freeze() convert an sset or smap into an immutable,
+ * compact form for data that is built once and then only searched.  All of
+ * the names are stored back to back, in sorted order, in a single blob, and
+ * an open-addressed hash index with 8-byte slots finds them.  A search hashes
+ * the key once, usually reads one index slot, and then compares against the
+ * name in the blob.  There is no per-name allocation: a frozen set takes 20
+ * to 36 bytes of overhead per name, depending on how full the index is,
+ * versus roughly 50 bytes for the nodes, allocator headers, and buckets of a
+ * live sset.
+ *
+ * The names in a frozen set or map are numbered 0 through n - 1 in sorted
+ * order, so iterating by index visits them alphabetically.
+ *
+ * sset_thaw() and smap_thaw() convert back into an ordinary sset or smap. */
+
+/* A slot in the hash index of a struct frozen_table. */
+struct frozen_slot {
+    uint32_t hash;              /* Hash of the name, as from hash_bytes(). */
+    uint32_t index;             /* 1 + index of the name, or 0 if empty. */
+};
+
+/* The part common to frozen_sset and frozen_smap. */
+struct frozen_table {
+    char *blob;                 /* Null-terminated names, back to back. */
+    uint32_t *offsets;          /* 'n + 1' offsets into 'blob'. */
+    struct frozen_slot *slots;  /* 'mask + 1' hash index slots. */
+    size_t mask;
+    size_t n;                   /* Number of names. */
+};
+
+/* A frozen set of strings. */
+typedef struct frozen_sset {
+    struct frozen_table table;
+} frozen_sset_t;
+
+/* A frozen map from strings to data. */
+typedef struct frozen_smap {
+    struct frozen_table table;
+    void **data;                /* 'table.n' data values, in name order. */
+} frozen_smap_t;
+
+/* Frozen sets. */
+void sset_freeze(frozen_sset_t *, const sset_t *);
+void sset_thaw(sset_t *, const frozen_sset_t *);
+void frozen_sset_destroy(frozen_sset_t *);
+
+static inline size_t frozen_sset_count(const frozen_sset_t *);
+static inline const char *frozen_sset_name(const frozen_sset_t *, size_t);
+bool frozen_sset_contains(const frozen_sset_t *, const char *);
+bool frozen_sset_contains_len(const frozen_sset_t *, const char *, size_t);
+
+/* Frozen maps. */
+void smap_freeze(frozen_smap_t *, const smap_t *);
+void smap_thaw(smap_t *, const frozen_smap_t *);
+void frozen_smap_destroy(frozen_smap_t *);
+
+static inline size_t frozen_smap_count(const frozen_smap_t *);
+static inline const char *frozen_smap_name(const frozen_smap_t *, size_t);
+static inline void *frozen_smap_data(const frozen_smap_t *, size_t);
+size_t frozen_smap_find(const frozen_smap_t *, const char *);
+size_t frozen_smap_find_len(const frozen_smap_t *, const char *, size_t);
+void *frozen_smap_find_data(const frozen_smap_t *, const char *);
+
+/* Returns the number of strings in 'fs'. */
+static inline size_t
+frozen_sset_count(const frozen_sset_t *fs)
+{
+    return fs->table.n;
+}
+
+/* Returns the string with index 'i' in 'fs', that is, the string that sorts
+ * in position 'i'. */
+static inline const char *
+frozen_sset_name(const frozen_sset_t *fs, size_t i)
+{
+    return &fs->table.blob[fs->table.offsets[i]];
+}
+
+/* Returns the number of mappings in 'fm'. */
+static inline size_t
+frozen_smap_count(const frozen_smap_t *fm)
+{
+    return fm->table.n;
+}
+
+/* Returns the name of the mapping with index 'i' in 'fm'. */
+static inline const char *
+frozen_smap_name(const frozen_smap_t *fm, size_t i)
+{
+    return &fm->table.blob[fm->table.offsets[i]];
+}
+
+/* Returns the data of the mapping with index 'i' in 'fm'. */
+static inline void *
+frozen_smap_data(const frozen_smap_t *fm, size_t i)
+{
+    return fm->data[i];
+}
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /* frozen.h */
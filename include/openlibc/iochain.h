@@ -0,0 +1,100 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OPENLIBC_IOCHAIN_H
+#define OPENLIBC_IOCHAIN_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/uio.h>
+
+#include "openlibc/compiler.h"
+#include "openlibc/dynamic-string.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A chain of output segments for scatter-gather I/O.
+ *
+ * An iochain accumulates output as a sequence of segments without copying
+ * large payloads.  Small pieces of output, such as headers, are copied into
+ * a buffer owned by the iochain, and consecutive copies share a segment.
+ * Large payloads are added by reference with iochain_put_ref(), which does
+ * not copy them, so the caller must keep them unchanged until they have been
+ * consumed or the iochain has been cleared or destroyed.
+ *
+ * iochain_writev() writes the chain to a file descriptor with writev(), and
+ * iochain_to_iovec() exposes it as an iovec array for use with sendmsg() or
+ * similar.  After a partial write, iochain_consume() drops the bytes that
+ * were written from the front of the chain.  iochain_flatten() copies the
+ * remaining contents into a ds, for destinations that need contiguous data.
+ *
+ * Usage example:
+ *
+ *     struct iochain chain = IOCHAIN_INITIALIZER;
+ *
+ *     iochain_put_format(&chain, "Content-Length: %zu\r\n\r\n", size);
+ *     iochain_put_ref(&chain, payload, size);
+ *     error = iochain_writev(&chain, fd);
+ *     ...
+ *     iochain_destroy(&chain);
+ */
+struct iochain {
+    ds_t buf;                   /* Owned data. */
+    struct iochain_seg *segs;   /* Segments, including consumed ones. */
+    size_t n_segs;              /* Number of elements in 'segs'. */
+    size_t allocated_segs;      /* Allocated elements in 'segs'. */
+    size_t first;               /* Index of first unconsumed segment. */
+    size_t length;              /* Unconsumed bytes. */
+    struct iovec *iov;          /* Storage for iochain_to_iovec(). */
+    size_t allocated_iov;       /* Allocated elements in 'iov'. */
+};
+
+#define IOCHAIN_INITIALIZER { DS_EMPTY_INITIALIZER, NULL, 0, 0, 0, 0, NULL, 0 }
+
+void iochain_init(struct iochain *);
+void iochain_clear(struct iochain *);
+void iochain_destroy(struct iochain *);
+
+void iochain_put_buffer(struct iochain *, const void *, size_t n);
+void iochain_put_cstr(struct iochain *, const char *);
+void iochain_put_format(struct iochain *, const char *, ...)
+    OLC_PRINTF_FORMAT(2, 3);
+void iochain_put_ref(struct iochain *, const void *, size_t n);
+
+/* Returns the number of bytes in 'chain' that have not been consumed. */
+static inline size_t
+iochain_length(const struct iochain *chain)
+{
+    return chain->length;
+}
+
+/* Returns true if 'chain' has no unconsumed bytes. */
+static inline bool
+iochain_is_empty(const struct iochain *chain)
+{
+    return !chain->length;
+}
+
+const struct iovec *iochain_to_iovec(struct iochain *, size_t *n_iov);
+void iochain_consume(struct iochain *, size_t n);
+void iochain_flatten(const struct iochain *, ds_t *);
+int iochain_writev(struct iochain *, int fd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* iochain.h */
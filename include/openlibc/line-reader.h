@@ -0,0 +1,58 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OPENLIBC_LINE_READER_H
+#define OPENLIBC_LINE_READER_H 1
+
+#include "openlibc/dynamic-string.h"
+#include "openlibc/strview.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Fast reading of lines from a file descriptor.
+ *
+ * A line reader reads its input in large blocks into a buffer that it owns
+ * and finds line boundaries with memchr(), so that it can return each line as
+ * a view into the buffer without copying it.  This is much faster than
+ * reading through stdio one character at a time, which makes it suitable for
+ * files of many gigabytes.
+ *
+ * Usage example:
+ *
+ *     struct line_reader *r = line_reader_create(fd);
+ *     strview_t line;
+ *     int error;
+ *
+ *     while (!(error = line_reader_next(r, &line))) {
+ *         ...process 'line'...
+ *     }
+ *     if (error != EOF) {
+ *         ...report read error 'error'...
+ *     }
+ *     line_reader_destroy(r);
+ */
+
+struct line_reader *line_reader_create(int fd);
+void line_reader_destroy(struct line_reader *);
+
+int line_reader_next(struct line_reader *, strview_t *line);
+int line_reader_get_line(struct line_reader *, ds_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* line-reader.h */
@@ -74,6 +74,12 @@ static inline bool olc_list_is_empty(const struct olc_list_t *);
 static inline bool olc_list_is_singleton(const struct olc_list_t *);
 static inline bool olc_list_is_short(const struct olc_list_t *);
 
+/* List sorting. */
+void olc_list_sort(struct olc_list_t *,
+                   int (*compare)(const struct olc_list_t *a,
+                                  const struct olc_list_t *b, void *aux),
+                   void *aux);
+
 #define LIST_FOR_EACH(ITER, MEMBER, LIST)                               \
     for (INIT_CONTAINER(ITER, (LIST)->next, MEMBER);                    \
          &(ITER)->MEMBER != (LIST);                                     \
@@ -0,0 +1,127 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OPENLIBC_SEGVEC_H
+#define OPENLIBC_SEGVEC_H 1
+
+#include <assert.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A segmented vector.
+ *
+ * A segvec stores fixed-size elements in a sequence of chunks, each of which
+ * holds the same power-of-two number of elements, found through a directory
+ * of chunk pointers.  Growing a segvec allocates a new chunk but never moves
+ * existing elements, so pointers to elements remain valid until the elements
+ * are popped or the segvec is cleared or destroyed, and appending never has
+ * to copy the whole vector.  The only copying is of the directory, which is
+ * smaller than the elements by a factor of the chunk size and which
+ * segvec_reserve() can allocate in advance, after which appends up to the
+ * reserved size do no allocation at all.
+ *
+ * Element 'i' is in chunk 'i >> chunk_shift', so indexing takes constant
+ * time.  Because each chunk is contiguous, code may process a segvec one
+ * chunk at a time, for example by dividing the chunks among threads, using
+ * segvec_n_chunks() and segvec_chunk().
+ *
+ * Usage example:
+ *
+ *     struct segvec sv;
+ *     size_t i;
+ *
+ *     segvec_init(&sv, sizeof(struct flow *), 0);
+ *     *(struct flow **) segvec_push(&sv) = flow;
+ *     ...
+ *     for (i = 0; i < segvec_size(&sv); i++) {
+ *         struct flow *f = *(struct flow **) segvec_at(&sv, i);
+ *         ...
+ *     }
+ *     segvec_destroy(&sv);
+ */
+struct segvec {
+    char **chunks;              /* Directory of chunks. */
+    size_t n_chunks;            /* Number of chunks allocated. */
+    size_t allocated_chunks;    /* Number of elements in 'chunks'. */
+    size_t n;                   /* Number of elements in use. */
+    size_t elem_size;           /* Size of each element, in bytes. */
+    unsigned int chunk_shift;   /* log2 of the number of elements per chunk. */
+};
+
+void segvec_init(struct segvec *, size_t elem_size, size_t chunk_size);
+void segvec_destroy(struct segvec *);
+void segvec_clear(struct segvec *);
+void segvec_reserve(struct segvec *, size_t n);
+
+void *segvec_push(struct segvec *);
+void *segvec_push_copy(struct segvec *, const void *elem);
+void segvec_pop(struct segvec *);
+
+/* Returns the number of elements in 'sv'. */
+static inline size_t
+segvec_size(const struct segvec *sv)
+{
+    return sv->n;
+}
+
+/* Returns a pointer to element 'i' in 'sv', which must be less than
+ * segvec_size(sv). */
+static inline void *
+segvec_at(const struct segvec *sv, size_t i)
+{
+    size_t mask = ((size_t) 1 << sv->chunk_shift) - 1;
+
+    assert(i < sv->n);
+    return sv->chunks[i >> sv->chunk_shift] + (i & mask) * sv->elem_size;
+}
+
+/* Returns the number of chunks that contain elements of 'sv'. */
+static inline size_t
+segvec_n_chunks(const struct segvec *sv)
+{
+    return (sv->n + ((size_t) 1 << sv->chunk_shift) - 1) >> sv->chunk_shift;
+}
+
+/* Returns a pointer to the first element in chunk 'chunk' of 'sv', which
+ * must be less than segvec_n_chunks(sv), and stores the number of elements
+ * in that chunk into '*n'.  Every chunk except the last one is full. */
+static inline void *
+segvec_chunk(const struct segvec *sv, size_t chunk, size_t *n)
+{
+    size_t first = chunk << sv->chunk_shift;
+    size_t chunk_size = (size_t) 1 << sv->chunk_shift;
+
+    assert(chunk < segvec_n_chunks(sv));
+    *n = sv->n - first < chunk_size ? sv->n - first : chunk_size;
+    return sv->chunks[chunk];
+}
+
+/* Iterates ELEM, a pointer to the element type, over the elements of SV,
+ * in order, with INDEX as the index of each.  Don't add or remove elements
+ * during iteration. */
+#define SEGVEC_FOR_EACH(ELEM, INDEX, SV)                                \
+    for ((INDEX) = 0;                                                   \
+         ((INDEX) < (SV)->n                                             \
+          ? ((ELEM) = segvec_at(SV, INDEX), 1)                          \
+          : 0);                                                         \
+         (INDEX)++)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* segvec.h */
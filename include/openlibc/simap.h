@@ -26,9 +26,16 @@
 extern "C" {
 #endif
 
-/* A map from strings to unsigned integers. */
+/* A map from strings to unsigned integers.
+ *
+ * 'fingerprint' is the XOR of a hash of each name-value pair in the map.  It
+ * is maintained as mappings are added, changed, and removed, so that
+ * simap_hash() is O(1) and simap_equal() can usually reject unequal maps
+ * without a full comparison.  Therefore, change a mapping's 'data' only
+ * through simap_put() or simap_increase(), not by assigning to it directly. */
 typedef struct simap {
     struct hmap map;            /* Contains "struct simap_node"s. */
+    uint32_t fingerprint;       /* Order-independent hash of contents. */
 } simap_t;
 
 struct simap_node {
@@ -37,7 +44,7 @@ struct simap_node {
     unsigned int data;
 };
 
-#define SIMAP_INITIALIZER(SIMAP) { HMAP_INITIALIZER(&(SIMAP)->map) }
+#define SIMAP_INITIALIZER(SIMAP) { HMAP_INITIALIZER(&(SIMAP)->map), 0 }
 
 #define SIMAP_FOR_EACH(SIMAP_NODE, SIMAP)                               \
     HMAP_FOR_EACH_INIT (SIMAP_NODE, node, &(SIMAP)->map,                \
@@ -17,6 +17,9 @@
 #ifndef SHASH_H
 #define SHASH_H 1
 
+#include <stdint.h>
+
+#include "openlibc/bloom.h"
 #include "openlibc/hmap.h"
 #include "openlibc/util.h"
 
@@ -30,11 +33,22 @@ struct smap_node {
     void *data;
 };
 
+/* A map from strings to arbitrary data.
+ *
+ * 'fingerprint' is the sum of the hashes of the names in the map, maintained
+ * as nodes are added and removed, so that smap_equal_keys() can usually
+ * reject maps with different keys in O(1) time.  A sum, rather than an XOR,
+ * keeps duplicate names from cancelling each other out.
+ *
+ * 'filter', if nonnull, is a Bloom filter over the names in the map that
+ * lookups consult first.  See smap_enable_filter(). */
 typedef struct shash {
     struct hmap map;
+    uint32_t fingerprint;       /* Sum of the name hashes of all nodes. */
+    struct bloom *filter;       /* Optional negative lookup accelerator. */
 } smap_t;
 
-#define SMAP_INITIALIZER(SMAP) { HMAP_INITIALIZER(&(SMAP)->map) }
+#define SMAP_INITIALIZER(SMAP) { HMAP_INITIALIZER(&(SMAP)->map), 0, NULL }
 
 #define SMAP_FOR_EACH(SMAP_NODE, SMAP)                               \
     HMAP_FOR_EACH_INIT (SMAP_NODE, node, &(SMAP)->map,                \
@@ -53,12 +67,14 @@ void smap_destroy(smap_t *);
 void smap_destroy_free_data(smap_t *);
 void smap_swap(smap_t *, smap_t *);
 void smap_moved(smap_t *);
+void smap_enable_filter(smap_t *);
+void smap_disable_filter(smap_t *);
 void smap_clear(smap_t *);
 void smap_clear_free_data(smap_t *);
 bool smap_is_empty(const smap_t *);
 size_t smap_count(const smap_t *);
-struct smap_node *shash_add(smap_t *, const char *, const void *);
-struct smap_node *shash_add_nocopy(smap_t *, char *, const void *);
+struct smap_node *smap_add(smap_t *, const char *, const void *);
+struct smap_node *smap_add_nocopy(smap_t *, char *, const void *);
 bool smap_add_once(smap_t *, const char *, const void *);
 void smap_add_assert(smap_t *, const char *, const void *);
 void *smap_replace(smap_t *, const char *, const void *data);
@@ -17,6 +17,7 @@
 #ifndef OPENLIBC_SSET_H
 #define OPENLIBC_SSET_H 1
 
+#include "openlibc/bloom.h"
 #include "openlibc/hmap.h"
 #include "util.h"
 
@@ -29,12 +30,19 @@ struct sset_node {
     char name[1];
 };
 
-/* A set of strings. */
+/* A set of strings.
+ *
+ * 'filter', if nonnull, is a Bloom filter that holds the hash of every string
+ * in the set (and possibly of some strings that have since been deleted).
+ * Lookups consult it first, so that a search for a string that is not in the
+ * set usually costs only a single cache line read.  See
+ * sset_enable_filter(). */
 typedef struct sset {
     struct hmap map;
+    struct bloom *filter;       /* Optional negative lookup accelerator. */
 } sset_t;
 
-#define SSET_INITIALIZER(SSET) { HMAP_INITIALIZER(&(SSET)->map) }
+#define SSET_INITIALIZER(SSET) { HMAP_INITIALIZER(&(SSET)->map), NULL }
 
 /* Basics. */
 void sset_init(sset_t *);
@@ -42,6 +50,8 @@ void sset_destroy(sset_t *);
 void sset_clone(sset_t *, const sset_t *);
 void sset_swap(sset_t *, sset_t *);
 void sset_moved(sset_t *);
+void sset_enable_filter(sset_t *);
+void sset_disable_filter(sset_t *);
 
 /* String parsing and formatting. */
 void sset_from_delimited_string(sset_t *, const char *s,
@@ -55,6 +65,7 @@ size_t sset_count(const sset_t *);
 
 /* Insertion. */
 struct sset_node *sset_add(sset_t *, const char *);
+struct sset_node *sset_add_len(sset_t *, const char *, size_t length);
 struct sset_node *sset_add_and_free(sset_t *, char *);
 void sset_add_assert(sset_t *, const char *);
 void sset_add_array(sset_t *, char **, size_t n);
@@ -68,6 +79,7 @@ char *sset_pop(sset_t *);
 
 /* Search. */
 struct sset_node *sset_find(const sset_t *, const char *);
+struct sset_node *sset_find_len(const sset_t *, const char *, size_t length);
 bool sset_contains(const sset_t *, const char *);
 bool sset_equals(const sset_t *, const sset_t *);
 
@@ -78,8 +90,27 @@ struct sset_position {
 struct sset_node *sset_at_position(const sset_t *,
                                    struct sset_position *);
 
-/* Set operations. */
+/* Set operations.
+ *
+ * The in-place forms replace their first argument by the result.  The
+ * "_move" forms also empty their second argument, moving its nodes into the
+ * first rather than copying them.  The sset_init_*() forms initialize a new
+ * set to the result without modifying either operand. */
 void sset_intersect(sset_t *, const sset_t *);
+void sset_union(sset_t *, const sset_t *);
+void sset_union_move(sset_t *, sset_t *);
+void sset_difference(sset_t *, const sset_t *);
+void sset_symmetric_difference(sset_t *, const sset_t *);
+void sset_symmetric_difference_move(sset_t *, sset_t *);
+
+void sset_init_intersection(sset_t *, const sset_t *, const sset_t *);
+void sset_init_union(sset_t *, const sset_t *, const sset_t *);
+void sset_init_difference(sset_t *, const sset_t *, const sset_t *);
+void sset_init_symmetric_difference(sset_t *,
+                                    const sset_t *, const sset_t *);
+
+bool sset_is_subset(const sset_t *, const sset_t *);
+bool sset_is_disjoint(const sset_t *, const sset_t *);
 
 /* Iteration macros. */
 #define SSET_FOR_EACH(NAME, SSET)               \
@@ -0,0 +1,47 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OPENLIBC_STRING_SORT_H
+#define OPENLIBC_STRING_SORT_H 1
+
+#include <stddef.h>
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/* String sorting.
+ *
+ * These functions sort strings into the same order as qsort() with a
+ * strcmp()-based comparison function, but much faster for large arrays.  They
+ * use multikey quicksort: each string is paired with an 8-byte big-endian
+ * copy of its next 8 bytes, so that most comparisons are integer comparisons
+ * on data that is already in cache, and strings that share a prefix are
+ * compared on it only once.
+ *
+ * Equal strings are ordered by address (of the string for string_sort(), of
+ * the object for string_sort_indirect()), so the result does not depend on
+ * the order of the input.
+ *
+ * Large arrays are split into chunks that are sorted and then merged on
+ * multiple threads.  The result is the same as sorting on a single thread. */
+
+void string_sort(const char **strings, size_t n);
+void string_sort_indirect(const void **objects, size_t n, size_t name_offset);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /* string-sort.h */
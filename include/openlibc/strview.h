@@ -0,0 +1,93 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OPENLIBC_STRVIEW_H
+#define OPENLIBC_STRVIEW_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A "string view", that is, a reference to 'length' bytes of a string that
+ * is stored elsewhere.  The bytes need not be null-terminated.  A string view
+ * does not own its bytes, so it is only valid as long as they are. */
+typedef struct strview {
+    const char *string;
+    size_t length;
+} strview_t;
+
+#define STRVIEW_INITIALIZER(STRING, LENGTH) { STRING, LENGTH }
+
+/* Returns a view of null-terminated string 's'. */
+static inline strview_t
+strview_from_cstr(const char *s)
+{
+    strview_t sv = { s, strlen(s) };
+    return sv;
+}
+
+/* Returns true if 'a' and 'b' contain the same bytes, false otherwise. */
+static inline bool
+strview_equals(strview_t a, strview_t b)
+{
+    return a.length == b.length && !memcmp(a.string, b.string, a.length);
+}
+
+/* Returns true if 'sv' contains the same bytes as null-terminated string
+ * 's', false otherwise. */
+static inline bool
+strview_equals_cstr(strview_t sv, const char *s)
+{
+    return !strncmp(sv.string, s, sv.length) && !s[sv.length];
+}
+
+char *strview_to_cstr(strview_t);
+
+/* Breaks a string into tokens separated by a set of delimiter characters,
+ * like strtok_r(), but without modifying or copying the string.
+ *
+ * Usage example:
+ *
+ *     struct strview_tokenizer t;
+ *     strview_t token;
+ *
+ *     strview_tokenizer_init(&t, strview_from_cstr("a b,,c"), " ,");
+ *     while (strview_tokenizer_next(&t, &token)) {
+ *         ...'token' is "a", then "b", then "c"...
+ *     }
+ *
+ * Where the CPU supports it, the tokenizer examines 16 bytes at a time when
+ * there are only a few delimiters. */
+struct strview_tokenizer {
+    const char *pos;            /* Next byte to examine. */
+    const char *end;            /* End of input. */
+    uint64_t bitmap[4];         /* Bit 'c' is set if 'c' is a delimiter. */
+    char simd[8];               /* The delimiters, if there are few enough. */
+    size_t n_simd;              /* Number of delimiters in 'simd', or 0. */
+};
+
+void strview_tokenizer_init(struct strview_tokenizer *, strview_t input,
+                            const char *delimiters);
+bool strview_tokenizer_next(struct strview_tokenizer *, strview_t *token);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* strview.h */
@@ -24,33 +24,62 @@
 extern "C" {
 #endif
 
+/* A vector of strings.
+ *
+ * Normally each string in an svec is a separate heap allocation owned by the
+ * svec.  A "pooled" svec, initialized with svec_init_pooled(), instead copies
+ * its strings into large shared blocks of memory, each string preceded by its
+ * length.  This makes adding strings and clearing the svec much cheaper and
+ * keeps the strings close together in memory.  'names' is the same in either
+ * mode, but the strings in a pooled svec may not be freed or replaced
+ * individually (though they may still be reordered).
+ *
+ * Once an svec grows large enough, svec_find() builds a hash index over its
+ * strings, which the svec functions keep up to date.  Code that reorders or
+ * replaces strings in 'names' directly, other than setting some of them to
+ * null for svec_compact(), must call svec_invalidate_index() afterward.
+ * Because svec_find() may build the index, concurrent calls to it on the same
+ * svec are not safe. */
 typedef struct svec {
     char **names;
     size_t n;
     size_t allocated;
+    struct svec_pool *pool;     /* Null if not pooled. */
+    struct svec_index *index;   /* Null if not (yet) indexed. */
 } svec_t;
 
-#define SVEC_EMPTY_INITIALIZER { NULL, 0, 0 }
+#define SVEC_EMPTY_INITIALIZER { NULL, 0, 0, NULL, NULL }
 
 void svec_init(svec_t *);
+void svec_init_pooled(svec_t *);
 void svec_clone(svec_t *, const svec_t *);
 void svec_destroy(svec_t *);
 void svec_clear(svec_t *);
 bool svec_is_empty(const svec_t *);
+void svec_reserve(svec_t *, size_t n);
 void svec_add(svec_t *, const char *);
+void svec_add_len(svec_t *, const char *, size_t len);
 void svec_add_nocopy(svec_t *, char *);
 void svec_del(svec_t *, const char *);
 void svec_append(svec_t *, const svec_t *);
+void svec_from_delimited_string(svec_t *, const char *s,
+                                const char *delimiters);
 void svec_terminate(svec_t *);
 void svec_sort(svec_t *);
 void svec_sort_unique(svec_t *);
 void svec_unique(svec_t *);
 void svec_compact(svec_t *);
+size_t svec_remove_if(svec_t *, bool (*pred)(const char *name, void *aux),
+                      void *aux);
 void svec_shuffle(svec_t *);
 void svec_diff(const svec_t *a, const svec_t *b,
                svec_t *a_only, svec_t *both, svec_t *b_only);
+void svec_diff_unsorted(const svec_t *a, const svec_t *b,
+                        svec_t *a_only, svec_t *both, svec_t *b_only);
 bool svec_contains(const svec_t *, const char *);
 size_t svec_find(const svec_t *, const char *);
+size_t svec_find_len(const svec_t *, const char *, size_t len);
+void svec_invalidate_index(svec_t *);
 bool svec_is_sorted(const svec_t *);
 bool svec_is_unique(const svec_t *);
 const char *svec_get_duplicate(const svec_t *);
@@ -62,6 +91,7 @@ char *svec_join(const svec_t *,
                 const char *delimiter, const char *terminator);
 const char *svec_back(const svec_t *);
 void svec_pop_back(svec_t *);
+size_t svec_len(const svec_t *, size_t index);
 
 /* Iterates over the names in SVEC, assigning each name in turn to NAME and its
  * index to INDEX. */
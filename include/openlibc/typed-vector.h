@@ -0,0 +1,250 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OPENLIBC_TYPED_VECTOR_H
+#define OPENLIBC_TYPED_VECTOR_H 1
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A vector that stores elements of any type by value.
+ *
+ * Unlike vector_t, which holds pointers to separately allocated elements,
+ * a typed vector keeps its elements in one contiguous array, which it
+ * reallocates as needed.  Elements are moved around with memcpy() and
+ * memmove(), so they must not contain pointers into themselves, and
+ * pointers to elements become invalid whenever the vector grows or shrinks
+ * or elements are inserted or erased before them.
+ *
+ * Declare a vector type with TVEC(TYPE), usually in a typedef, and
+ * initialize it with TVEC_INITIALIZER or TVEC_INIT.  The operations are
+ * macros that may evaluate their vector argument more than once, so it
+ * should not have side effects.  For example:
+ *
+ *     struct pkt_meta { uint32_t hash; uint16_t port; ... };
+ *     typedef TVEC(struct pkt_meta) pkt_meta_vec;
+ *
+ *     pkt_meta_vec metas = TVEC_INITIALIZER;
+ *     struct pkt_meta *m;
+ *
+ *     TVEC_PUSH(&metas, ((struct pkt_meta) { .hash = h, .port = p }));
+ *     TVEC_FOR_EACH (m, &metas) {
+ *         ...
+ *     }
+ *     TVEC_DESTROY(&metas);
+ *
+ * C++ code may use the openlibc::tvec<T> wrapper below instead. */
+#define TVEC(TYPE)                                                      \
+    struct {                                                            \
+        TYPE *data;             /* Elements. */                         \
+        size_t n;               /* Number of elements in use. */        \
+        size_t allocated;       /* Number of elements allocated. */     \
+    }
+
+#define TVEC_INITIALIZER { NULL, 0, 0 }
+
+#define TVEC_INIT(V) ((V)->data = NULL, (V)->n = (V)->allocated = 0)
+
+/* Frees the memory owned by V, leaving it empty. */
+#define TVEC_DESTROY(V) (free((V)->data), TVEC_INIT(V))
+
+/* Removes all of the elements from V, without freeing its memory. */
+#define TVEC_CLEAR(V) ((void) ((V)->n = 0))
+
+#define TVEC_SIZEOF(V) sizeof *(V)->data
+
+/* Ensures that V has room for at least N elements. */
+#define TVEC_RESERVE(V, N)                                              \
+    ((void) ((N) > (V)->allocated                                       \
+             ? ((V)->data = tvec_reserve__((V)->data, &(V)->allocated,  \
+                                           (N), TVEC_SIZEOF(V)))        \
+             : NULL))
+
+/* Reduces the memory allocated by V to what its elements need. */
+#define TVEC_SHRINK_TO_FIT(V)                                           \
+    ((void) ((V)->data = tvec_shrink__((V)->data, &(V)->allocated,      \
+                                       (V)->n, TVEC_SIZEOF(V))))
+
+/* Appends VALUE to V.  Wrap VALUE in parentheses if it is a compound
+ * literal that contains commas. */
+#define TVEC_PUSH(V, VALUE)                                             \
+    ((void) (TVEC_RESERVE(V, (V)->n + 1),                               \
+             (V)->data[(V)->n] = (VALUE),                               \
+             (V)->n++))
+
+/* Appends an uninitialized element to V and returns a pointer to it. */
+#define TVEC_PUSH_UNINIT(V)                                             \
+    (TVEC_RESERVE(V, (V)->n + 1), &(V)->data[(V)->n++])
+
+/* Removes the last element from V, which must not be empty, and returns
+ * it. */
+#define TVEC_POP(V) (assert((V)->n > 0), (V)->data[--(V)->n])
+
+/* Returns the last element of V, which must not be empty. */
+#define TVEC_LAST(V) (assert((V)->n > 0), (V)->data[(V)->n - 1])
+
+/* Inserts VALUE into V at position IDX, which must be no greater than the
+ * number of elements, moving later elements up by one.  VALUE is stored past
+ * the end of V before anything moves, so it may be an element of V. */
+#define TVEC_INSERT(V, IDX, VALUE)                                      \
+    ((void) (TVEC_RESERVE(V, (V)->n + 1),                               \
+             (V)->data[(V)->n] = (VALUE),                               \
+             tvec_insert__((V)->data, &(V)->n, (IDX), TVEC_SIZEOF(V))))
+
+/* Removes the element at position IDX from V, moving later elements down by
+ * one. */
+#define TVEC_ERASE(V, IDX) TVEC_ERASE_N(V, IDX, 1)
+
+/* Removes the N elements starting at position IDX from V, moving later
+ * elements down. */
+#define TVEC_ERASE_N(V, IDX, N)                                         \
+    tvec_erase__((V)->data, &(V)->n, (IDX), (N), TVEC_SIZEOF(V))
+
+/* Sorts the elements of V with qsort() and CMP. */
+#define TVEC_SORT(V, CMP)                                               \
+    ((V)->n > 1 ? qsort((V)->data, (V)->n, TVEC_SIZEOF(V), CMP) : (void) 0)
+
+/* Iterates ITER, a pointer to the element type, over the elements of V. */
+#define TVEC_FOR_EACH(ITER, V)                                          \
+    for ((ITER) = (V)->data; (ITER) && (ITER) < (V)->data + (V)->n;     \
+         (ITER)++)
+
+/* Implementation details of the TVEC macros. */
+void *tvec_reserve__(void *data, size_t *allocated, size_t n,
+                     size_t elem_size);
+void *tvec_shrink__(void *data, size_t *allocated, size_t n,
+                    size_t elem_size);
+void tvec_insert__(void *data, size_t *n, size_t idx, size_t elem_size);
+void tvec_erase__(void *data, size_t *n, size_t idx, size_t count,
+                  size_t elem_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef __cplusplus
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+namespace openlibc {
+
+/* A C++ wrapper around the same representation as TVEC(T), for elements that
+ * may be copied bytewise. */
+template <typename T>
+class tvec {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "tvec elements must be trivially copyable");
+
+public:
+    tvec() : data_(nullptr), n_(0), allocated_(0) {}
+    tvec(const tvec &other) : tvec() { *this = other; }
+    tvec(tvec &&other) noexcept
+        : data_(other.data_), n_(other.n_), allocated_(other.allocated_)
+    {
+        other.data_ = nullptr;
+        other.n_ = other.allocated_ = 0;
+    }
+    ~tvec() { free(data_); }
+
+    tvec &operator=(const tvec &other)
+    {
+        if (this != &other) {
+            n_ = 0;
+            reserve(other.n_);
+            if (other.n_) {
+                std::memcpy(static_cast<void *>(data_), other.data_,
+                            other.n_ * sizeof(T));
+            }
+            n_ = other.n_;
+        }
+        return *this;
+    }
+    tvec &operator=(tvec &&other) noexcept
+    {
+        std::swap(data_, other.data_);
+        std::swap(n_, other.n_);
+        std::swap(allocated_, other.allocated_);
+        return *this;
+    }
+
+    T *data() { return data_; }
+    const T *data() const { return data_; }
+    size_t size() const { return n_; }
+    size_t capacity() const { return allocated_; }
+    bool empty() const { return !n_; }
+
+    T &operator[](size_t i) { return data_[i]; }
+    const T &operator[](size_t i) const { return data_[i]; }
+    T &back() { assert(n_ > 0); return data_[n_ - 1]; }
+    const T &back() const { assert(n_ > 0); return data_[n_ - 1]; }
+
+    T *begin() { return data_; }
+    T *end() { return data_ + n_; }
+    const T *begin() const { return data_; }
+    const T *end() const { return data_ + n_; }
+
+    void reserve(size_t n)
+    {
+        if (n > allocated_) {
+            data_ = static_cast<T *>(tvec_reserve__(data_, &allocated_, n,
+                                                    sizeof(T)));
+        }
+    }
+    void shrink_to_fit()
+    {
+        data_ = static_cast<T *>(tvec_shrink__(data_, &allocated_, n_,
+                                               sizeof(T)));
+    }
+    void clear() { n_ = 0; }
+
+    void push_back(const T &value)
+    {
+        T copy = value;     /* 'value' might be an element of this vector. */
+        reserve(n_ + 1);
+        data_[n_++] = copy;
+    }
+    T pop_back() { assert(n_ > 0); return data_[--n_]; }
+
+    void insert(size_t idx, const T &value)
+    {
+        T copy = value;
+        reserve(n_ + 1);
+        data_[n_] = copy;
+        tvec_insert__(data_, &n_, idx, sizeof(T));
+    }
+    void erase(size_t idx, size_t count = 1)
+    {
+        tvec_erase__(data_, &n_, idx, count, sizeof(T));
+    }
+
+    template <typename Less>
+    void sort(Less less) { std::sort(begin(), end(), less); }
+    void sort() { std::sort(begin(), end()); }
+
+private:
+    T *data_;
+    size_t n_;
+    size_t allocated_;
+};
+
+} /* namespace openlibc */
+#endif /* __cplusplus */
+
+#endif /* typed-vector.h */
@@ -0,0 +1,45 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OPENLIBC_UTF8_H
+#define OPENLIBC_UTF8_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "openlibc/dynamic-string.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* UTF-8 validation.
+ *
+ * These functions accept exactly the well-formed UTF-8 sequences defined by
+ * the Unicode Standard, so they reject overlong encodings, surrogates (U+D800
+ * to U+DFFF), code points above U+10FFFF, and truncated sequences.  They
+ * validate 16 bytes at a time when the CPU supports SSSE3 and skip runs of
+ * ASCII quickly.  Null bytes are valid UTF-8 and receive no special
+ * treatment. */
+
+bool utf8_is_valid(const char *, size_t n);
+size_t utf8_valid_prefix(const char *, size_t n);
+
+void ds_put_utf8_sanitized(ds_t *, const char *, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* utf8.h */
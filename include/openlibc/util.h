@@ -39,6 +39,9 @@
 /* Returns X rounded down to the nearest multiple of Y. */
 #define ROUND_DOWN(X, Y) ((X) / (Y) * (Y))
 
+/* Returns the number of elements in ARRAY. */
+#define ARRAY_SIZE(ARRAY) (sizeof ARRAY / sizeof ARRAY[0])
+
 
 
 /* This is a void expression that issues a compiler error if POINTER cannot be
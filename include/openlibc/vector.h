@@ -1,6 +1,7 @@
 #ifndef OPENLIBC_VECTOR_H
 #define OPENLIBC_VECTOR_H
 
+#include <stdbool.h>
 #include <stddef.h>
 
 #ifdef __cplusplus
@@ -20,10 +21,16 @@ void vector_init(vector_t *vector, size_t capacity);
 
 void vector_destroy(vector_t *vector);
 
+void vector_reserve(vector_t *vector, size_t capacity);
+
+void vector_shrink_to_fit(vector_t *vector);
+
 int vector_index_of(vector_t *vector, const void *element);
 
 void vector_add(vector_t *vector, void *element);
 
+void vector_add_array(vector_t *vector, void *const *elements, size_t n);
+
 void *vector_pop(vector_t *vector);
 
 void vector_insert_at(vector_t *vector, size_t index, void *element);
@@ -32,6 +39,11 @@ void vector_remove(vector_t *vector, void *element);
 
 void *vector_remove_at(vector_t *vector, size_t index);
 
+void *vector_swap_remove_at(vector_t *vector, size_t index);
+
+size_t vector_remove_if(vector_t *vector,
+                        bool (*pred)(void *element, void *aux), void *aux);
+
 
 #ifdef __cplusplus
 };
@@ -0,0 +1,300 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Base64 encoding and decoding, as specified in RFC 4648, with either the
+ * standard alphabet or the URL and filename safe alphabet.
+ *
+ * Both directions write directly into space obtained from ds_put_uninit(),
+ * without intermediate buffers.  With SSSE3, encoding converts 12 bytes and
+ * decoding converts 16 characters at a time, using the techniques described
+ * by Wojciech Mula and Daniel Lemire in "Faster Base64 Encoding and Decoding
+ * Using AVX2 Instructions", restricted to 128-bit vectors.  Otherwise, and
+ * for the tails of the input, they work through lookup tables. */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "openlibc/dynamic-string.h"
+#include "simd.h"
+#include "util.h"
+
+#if HAVE_X86_SIMD
+#include <tmmintrin.h>
+#endif
+
+static const char base64_std_digits[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char base64_url_digits[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+/* Values of base64 digits in the 7-bit character set, with XX for characters
+ * that are not digits. */
+#define XX 0xff
+static const uint8_t base64_std_values[128] = {
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, 62, XX, XX, XX, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, XX, XX, XX, XX, XX, XX,
+    XX,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, XX, XX, XX, XX, XX,
+    XX, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, XX, XX, XX, XX, XX,
+};
+static const uint8_t base64_url_values[128] = {
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, 62, XX, XX,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, XX, XX, XX, XX, XX, XX,
+    XX,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, XX, XX, XX, XX, 63,
+    XX, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, XX, XX, XX, XX, XX,
+};
+#undef XX
+
+#if HAVE_X86_SIMD
+/* Encodes the first 12 bytes of each 16 bytes in 'src', advancing by 12
+ * bytes each time, for as long as 16 bytes remain in the 'n' bytes at 'src',
+ * into 16 base64 digits each in 'dst'.  Returns the number of bytes of 'src'
+ * consumed, which is a multiple of 12. */
+static size_t TARGET_SSSE3
+base64_encode_ssse3(char *dst, const uint8_t *src, size_t n, bool url)
+{
+    /* Spreads each 3 input bytes A, B, C over a 32-bit lane as B, A, C, B,
+     * so that each 6-bit index lies within one 16-bit half. */
+    const __m128i spread = _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4,
+                                         7, 6, 8, 7, 10, 9, 11, 10);
+    /* Offsets to add to each index, selected by index class (see below). */
+    const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52,
+                                          (url ? '-' : '+') - 62,
+                                          (url ? '_' : '/') - 63,
+                                          'A', 0, 0);
+    const uint8_t *start = src;
+
+    for (; n >= 16; n -= 12, src += 12, dst += 16) {
+        __m128i in = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) src),
+                                      spread);
+
+        /* Move each 6-bit field to the bottom of its own byte. */
+        __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+        __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+        __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+        __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+        __m128i indexes = _mm_or_si128(t1, t3);
+
+        /* Classify the indexes: 0...25 become 13, 26...51 become 0, and
+         * 52...63 become 1...12. */
+        __m128i kind = _mm_subs_epu8(indexes, _mm_set1_epi8(51));
+        __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indexes);
+        kind = _mm_or_si128(kind, _mm_and_si128(upper, _mm_set1_epi8(13)));
+
+        _mm_storeu_si128((__m128i *) dst,
+                         _mm_add_epi8(indexes,
+                                      _mm_shuffle_epi8(offsets, kind)));
+    }
+    return src - start;
+}
+
+/* Returns mask bytes that are all-ones where 'x' is between 'lo' and 'hi',
+ * inclusive, and zero elsewhere. */
+static inline __m128i
+base64_in_range(__m128i x, char lo, char hi)
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8(lo - 1)),
+                         _mm_cmplt_epi8(x, _mm_set1_epi8(hi + 1)));
+}
+
+/* Decodes base64 digits from the 'n' characters in 'src' into 'dst', 16
+ * characters into 12 bytes at a time, until fewer than 16 characters remain
+ * or a group of 16 contains a character that is not a digit, such as
+ * padding.  Returns the number of characters consumed, which is a multiple
+ * of 16. */
+static size_t TARGET_SSSE3
+base64_decode_ssse3(uint8_t *dst, const char *src, size_t n, bool url)
+{
+    /* Picks out the 3 output bytes at the bottom of each 32-bit lane, in
+     * big-endian order. */
+    const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8,
+                                       14, 13, 12, -1, -1, -1, -1);
+    const char *start = src;
+
+    for (; n >= 16; n -= 16, src += 16, dst += 12) {
+        __m128i x = _mm_loadu_si128((const __m128i *) src);
+        __m128i upper = base64_in_range(x, 'A', 'Z');
+        __m128i lower = base64_in_range(x, 'a', 'z');
+        __m128i digit = base64_in_range(x, '0', '9');
+        __m128i c62 = _mm_cmpeq_epi8(x, _mm_set1_epi8(url ? '-' : '+'));
+        __m128i c63 = _mm_cmpeq_epi8(x, _mm_set1_epi8(url ? '_' : '/'));
+        __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower),
+                                     _mm_or_si128(digit,
+                                                  _mm_or_si128(c62, c63)));
+        __m128i delta, values, merged;
+        uint8_t out[16];
+
+        if (_mm_movemask_epi8(valid) != 0xffff) {
+            break;
+        }
+
+        /* Convert each digit to its 6-bit value. */
+        delta = _mm_or_si128(
+            _mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-'A')),
+                         _mm_and_si128(lower, _mm_set1_epi8(26 - 'a'))),
+            _mm_or_si128(_mm_and_si128(digit, _mm_set1_epi8(52 - '0')),
+                         _mm_or_si128(
+                             _mm_and_si128(c62, _mm_set1_epi8(62 - (url
+                                                                    ? '-'
+                                                                    : '+'))),
+                             _mm_and_si128(c63, _mm_set1_epi8(63 - (url
+                                                                    ? '_'
+                                                                    : '/'))))));
+        values = _mm_add_epi8(x, delta);
+
+        /* Merge pairs of 6-bit values into 12 bits, then pairs of those into
+         * 24 bits per 32-bit lane. */
+        merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+        merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+
+        _mm_storeu_si128((__m128i *) out, _mm_shuffle_epi8(merged, pack));
+        memcpy(dst, out, 12);
+    }
+    return src - start;
+}
+#endif
+
+/* Appends the 'n' bytes in 'data' to 'ds' encoded in base64.  If 'url' is
+ * false, uses the standard alphabet and pads the output with "=" to a
+ * multiple of 4 characters.  If 'url' is true, uses the URL and filename safe
+ * alphabet, with "-" and "_" in place of "+" and "/", and omits padding, as
+ * usual for that alphabet. */
+void
+ds_put_base64(ds_t *ds, const void *data, size_t n, bool url)
+{
+    const char *digits = url ? base64_url_digits : base64_std_digits;
+    size_t out_len = n / 3 * 4 + (n % 3 == 0 ? 0 : url ? n % 3 + 1 : 4);
+    const uint8_t *src = data;
+    char *dst = ds_put_uninit(ds, out_len);
+
+#if HAVE_X86_SIMD
+    if (n >= 16 && cpu_has_ssse3()) {
+        size_t done = base64_encode_ssse3(dst, src, n, url);
+
+        src += done;
+        dst += done / 3 * 4;
+        n -= done;
+    }
+#endif
+    for (; n >= 3; n -= 3, src += 3, dst += 4) {
+        uint32_t x = (src[0] << 16) | (src[1] << 8) | src[2];
+
+        dst[0] = digits[x >> 18];
+        dst[1] = digits[(x >> 12) & 0x3f];
+        dst[2] = digits[(x >> 6) & 0x3f];
+        dst[3] = digits[x & 0x3f];
+    }
+    if (n) {
+        uint32_t x = (src[0] << 16) | (n > 1 ? src[1] << 8 : 0);
+
+        *dst++ = digits[x >> 18];
+        *dst++ = digits[(x >> 12) & 0x3f];
+        if (n > 1) {
+            *dst++ = digits[(x >> 6) & 0x3f];
+        }
+        if (!url) {
+            *dst++ = '=';
+            if (n == 1) {
+                *dst++ = '=';
+            }
+        }
+    }
+}
+
+/* Decodes the 'n' base64 characters in 's' and appends the bytes that they
+ * represent to 'ds'.  If 'url' is false, 's' must use the standard alphabet,
+ * otherwise the URL and filename safe alphabet.  Either way, padding is
+ * optional, but if present it must pad 's' to a multiple of 4 characters.
+ *
+ * Returns 0 if successful.  Returns EINVAL, without modifying 'ds', if 's'
+ * contains a character outside the alphabet (including white space), has
+ * an impossible length or misplaced padding, or does not encode a whole
+ * number of bytes (that is, its final digit has nonzero unused bits). */
+int
+ds_put_base64_decode(ds_t *ds, const char *s, size_t n, bool url)
+{
+    const uint8_t *values = url ? base64_url_values : base64_std_values;
+    const unsigned char *src = (const unsigned char *) s;
+    size_t length = ds->length;
+    uint8_t *dst;
+    uint32_t bad;
+
+    if (n % 4 == 0 && n && src[n - 1] == '=') {
+        n -= src[n - 2] == '=' ? 2 : 1;
+    }
+    if (n % 4 == 1) {
+        return EINVAL;
+    }
+
+    dst = (uint8_t *) ds_put_uninit(ds, n / 4 * 3 + (n % 4 ? n % 4 - 1 : 0));
+#if HAVE_X86_SIMD
+    if (n >= 16 && cpu_has_ssse3()) {
+        size_t done = base64_decode_ssse3(dst, s, n, url);
+
+        src += done;
+        dst += done / 4 * 3;
+        n -= done;
+    }
+#endif
+
+    /* Each invalid character sets a bit above the low 6 bits in 'bad'. */
+#define BASE64_VALUE(C) (values[(C) & 0x7f] | ((C) & 0x80))
+    bad = 0;
+    for (; n >= 4; n -= 4, src += 4, dst += 3) {
+        uint32_t a = BASE64_VALUE(src[0]);
+        uint32_t b = BASE64_VALUE(src[1]);
+        uint32_t c = BASE64_VALUE(src[2]);
+        uint32_t d = BASE64_VALUE(src[3]);
+        uint32_t x = (a << 18) | (b << 12) | (c << 6) | d;
+
+        bad |= a | b | c | d;
+        dst[0] = x >> 16;
+        dst[1] = x >> 8;
+        dst[2] = x;
+    }
+    if (n) {
+        uint32_t a = BASE64_VALUE(src[0]);
+        uint32_t b = BASE64_VALUE(src[1]);
+        uint32_t c = n > 2 ? BASE64_VALUE(src[2]) : 0;
+        uint32_t x = (a << 18) | (b << 12) | (c << 6);
+
+        bad |= a | b | c;
+        /* The bits below the last whole byte must be zero. */
+        bad |= x & (n > 2 ? 0xff : 0xffff) ? 0xff : 0;
+        dst[0] = x >> 16;
+        if (n > 2) {
+            dst[1] = x >> 8;
+        }
+    }
+#undef BASE64_VALUE
+
+    if (bad & ~0x3f) {
+        ds_truncate(ds, length);
+        return EINVAL;
+    }
+    return 0;
+}
@@ -0,0 +1,59 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "openlibc/bloom.h"
+
+#include <string.h>
+
+#include "util.h"
+
+/* Number of hashes per block that a filter is sized for.  A 512-bit block
+ * holding 32 hashes averages 16 bits per hash. */
+#define BLOOM_HASHES_PER_BLOCK 32
+
+/* Initializes 'bloom' as an empty filter sized for at least 'capacity'
+ * hashes. */
+void
+bloom_init(struct bloom *bloom, size_t capacity)
+{
+    size_t n_blocks = 1;
+
+    while (n_blocks * BLOOM_HASHES_PER_BLOCK < capacity) {
+        n_blocks *= 2;
+    }
+
+    bloom->blocks = xzalloc_cacheline(n_blocks * BLOOM_BLOCK_WORDS
+                                      * sizeof *bloom->blocks);
+    bloom->mask = n_blocks - 1;
+    bloom->n = 0;
+    bloom->capacity = n_blocks * BLOOM_HASHES_PER_BLOCK;
+}
+
+/* Frees the memory that 'bloom' uses. */
+void
+bloom_destroy(struct bloom *bloom)
+{
+    if (bloom) {
+        free_cacheline(bloom->blocks);
+    }
+}
+
+/* Removes all of the hashes from 'bloom', without changing its size. */
+void
+bloom_clear(struct bloom *bloom)
+{
+    memset(bloom->blocks, 0,
+           (bloom->mask + 1) * BLOOM_BLOCK_WORDS * sizeof *bloom->blocks);
+    bloom->n = 0;
+}
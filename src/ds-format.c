@@ -0,0 +1,484 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Precompiled printf() formats.
+ *
+ * ds_format_compile() parses a format string once into a sequence of
+ * operations: copying literal text, formatting a plain %d, %i, %u, %x, %X,
+ * %s, or %c conversion (with any integer length modifier but no flags, width,
+ * or precision) directly, and passing any other single conversion to
+ * ds_put_format().  Formats that use features that cannot be split up this
+ * way, such as positional arguments or %n, are passed to ds_put_format() as a
+ * whole. */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "openlibc/dynamic-string.h"
+#include "util.h"
+
+enum ds_format_op_type {
+    DS_OP_LITERAL,              /* Copy 'length' bytes at 'offset'. */
+    DS_OP_SIGNED,               /* Plain %d or %i. */
+    DS_OP_UNSIGNED,             /* Plain %u, %x, or %X. */
+    DS_OP_STRING,               /* Plain %s. */
+    DS_OP_CHAR,                 /* Plain %c. */
+    DS_OP_GENERIC,              /* Any other conversion, at 'offset'. */
+};
+
+/* The type of the argument for a conversion. */
+enum ds_format_arg {
+    DS_ARG_NONE,
+    DS_ARG_CHAR,                /* hh (promoted to int). */
+    DS_ARG_SHORT,               /* h (promoted to int). */
+    DS_ARG_INT,
+    DS_ARG_LONG,                /* l */
+    DS_ARG_LLONG,               /* ll, q */
+    DS_ARG_INTMAX,              /* j */
+    DS_ARG_SIZE,                /* z, Z */
+    DS_ARG_PTRDIFF,             /* t */
+    DS_ARG_DOUBLE,
+    DS_ARG_LDOUBLE,             /* L with a floating-point conversion. */
+    DS_ARG_POINTER,
+};
+
+struct ds_format_op {
+    enum ds_format_op_type type;
+    enum ds_format_arg arg;
+    char conversion;            /* Conversion character, e.g. 'x'. */
+    int n_stars;                /* DS_OP_GENERIC: '*' widths/precisions. */
+    size_t offset;              /* Offset into 'text'. */
+    size_t length;              /* DS_OP_LITERAL: number of bytes. */
+};
+
+struct ds_format {
+    char *format;               /* Copy of the original format. */
+    char *text;                 /* Literals and null-terminated specs. */
+    struct ds_format_op *ops;
+    size_t n_ops;
+    bool whole;                 /* Pass 'format' to ds_put_format() whole? */
+};
+
+static struct ds_format_op *
+ds_format_add_op(struct ds_format *f, size_t *allocated,
+                 enum ds_format_op_type type)
+{
+    struct ds_format_op *op;
+
+    if (f->n_ops >= *allocated) {
+        f->ops = x2nrealloc(f->ops, allocated, sizeof *f->ops);
+    }
+    op = &f->ops[f->n_ops++];
+    memset(op, 0, sizeof *op);
+    op->type = type;
+    return op;
+}
+
+/* Appends 'n' literal bytes starting at 's' to 'f', merging them with the
+ * previous op if it is also a literal. */
+static void
+ds_format_add_literal(struct ds_format *f, size_t *allocated, ds_t *text,
+                      const char *s, size_t n)
+{
+    struct ds_format_op *op;
+
+    if (!n) {
+        return;
+    }
+    op = f->n_ops ? &f->ops[f->n_ops - 1] : NULL;
+    if (!op || op->type != DS_OP_LITERAL
+        || op->offset + op->length != text->length) {
+        op = ds_format_add_op(f, allocated, DS_OP_LITERAL);
+        op->offset = text->length;
+    }
+    ds_put_buffer(text, s, n);
+    op->length += n;
+}
+
+/* Parses the conversion specification that starts at 'spec', just after the
+ * '%', and adds an op for it to 'f'.  Returns the first byte after the
+ * specification, or NULL if the format must be passed to ds_put_format()
+ * whole. */
+static const char *
+ds_format_parse_spec(struct ds_format *f, size_t *allocated, ds_t *text,
+                     const char *spec)
+{
+    enum ds_format_arg arg = DS_ARG_INT;
+    struct ds_format_op *op;
+    bool plain = true;
+    int n_stars = 0;
+    const char *p = spec;
+
+    /* Flags. */
+    while (*p && strchr("-+ #0'I", *p)) {
+        plain = false;
+        p++;
+    }
+
+    /* Width and precision.  A '$' means positional arguments. */
+    if (*p == '*') {
+        n_stars++;
+        p++;
+    }
+    while (*p >= '0' && *p <= '9') {
+        p++;
+    }
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            n_stars++;
+            p++;
+        }
+        while (*p >= '0' && *p <= '9') {
+            p++;
+        }
+    }
+    if (*p == '$') {
+        return NULL;
+    }
+    if (p != spec) {
+        plain = false;
+    }
+
+    /* Length modifier. */
+    switch (*p) {
+    case 'h':
+        p++;
+        if (*p == 'h') {
+            p++;
+            arg = DS_ARG_CHAR;
+        } else {
+            arg = DS_ARG_SHORT;
+        }
+        break;
+    case 'l':
+        p++;
+        if (*p == 'l') {
+            p++;
+            arg = DS_ARG_LLONG;
+        } else {
+            arg = DS_ARG_LONG;
+        }
+        break;
+    case 'q':
+        p++;
+        arg = DS_ARG_LLONG;
+        break;
+    case 'j':
+        p++;
+        arg = DS_ARG_INTMAX;
+        break;
+    case 'z':
+    case 'Z':
+        p++;
+        arg = DS_ARG_SIZE;
+        break;
+    case 't':
+        p++;
+        arg = DS_ARG_PTRDIFF;
+        break;
+    case 'L':
+        p++;
+        arg = DS_ARG_LDOUBLE;
+        break;
+    }
+
+    /* Conversion. */
+    switch (*p) {
+    case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+        if (arg == DS_ARG_LDOUBLE) {
+            return NULL;
+        }
+        op = ds_format_add_op(f, allocated,
+                              (!plain || *p == 'o' ? DS_OP_GENERIC
+                               : *p == 'd' || *p == 'i' ? DS_OP_SIGNED
+                               : DS_OP_UNSIGNED));
+        break;
+
+    case 'e': case 'E': case 'f': case 'F': case 'g': case 'G':
+    case 'a': case 'A':
+        if (arg != DS_ARG_INT && arg != DS_ARG_LONG
+            && arg != DS_ARG_LDOUBLE) {
+            return NULL;
+        }
+        arg = arg == DS_ARG_LDOUBLE ? DS_ARG_LDOUBLE : DS_ARG_DOUBLE;
+        op = ds_format_add_op(f, allocated, DS_OP_GENERIC);
+        break;
+
+    case 's': case 'c': case 'p':
+        if (arg != DS_ARG_INT) {
+            /* Wide characters and strings. */
+            return NULL;
+        }
+        if (*p != 'c') {
+            arg = DS_ARG_POINTER;
+        }
+        op = ds_format_add_op(f, allocated,
+                              (!plain || *p == 'p' ? DS_OP_GENERIC
+                               : *p == 's' ? DS_OP_STRING
+                               : DS_OP_CHAR));
+        break;
+
+    default:
+        /* %n, %m, or something unknown. */
+        return NULL;
+    }
+
+    op->arg = arg;
+    op->conversion = *p;
+    op->n_stars = n_stars;
+    if (op->type == DS_OP_GENERIC) {
+        op->offset = text->length;
+        ds_put_char(text, '%');
+        ds_put_buffer(text, spec, p + 1 - spec);
+        ds_put_char(text, '\0');
+    }
+    return p + 1;
+}
+
+/* Parses printf()-style 'format' and returns a compiled form of it for use
+ * with ds_put_compiled().  The caller must eventually free the compiled
+ * format with ds_format_destroy().
+ *
+ * Compiling is worthwhile for a format that is used many times. */
+struct ds_format *
+ds_format_compile(const char *format)
+{
+    struct ds_format *f = xmalloc(sizeof *f);
+    ds_t text = DS_EMPTY_INITIALIZER;
+    size_t allocated = 0;
+    const char *p = format;
+
+    f->format = xmemdup0(format, strlen(format));
+    f->ops = NULL;
+    f->n_ops = 0;
+    f->whole = false;
+
+    while (*p) {
+        const char *percent = strchr(p, '%');
+
+        if (!percent) {
+            ds_format_add_literal(f, &allocated, &text, p, strlen(p));
+            break;
+        }
+        ds_format_add_literal(f, &allocated, &text, p, percent - p);
+        if (percent[1] == '%') {
+            ds_format_add_literal(f, &allocated, &text, "%", 1);
+            p = percent + 2;
+        } else {
+            p = ds_format_parse_spec(f, &allocated, &text, percent + 1);
+            if (!p) {
+                f->whole = true;
+                break;
+            }
+        }
+    }
+
+    f->text = ds_steal_cstr(&text);
+    return f;
+}
+
+/* Frees 'f', which may be null. */
+void
+ds_format_destroy(struct ds_format *f)
+{
+    if (f) {
+        free(f->format);
+        free(f->text);
+        free(f->ops);
+        free(f);
+    }
+}
+
+/* Fetches an integer argument of type 'arg' from 'args' and returns it,
+ * converted as the signed version of that type. */
+static int64_t
+ds_format_get_signed(enum ds_format_arg arg, va_list *args)
+{
+    switch (arg) {
+    case DS_ARG_CHAR:
+        return (signed char) va_arg(*args, int);
+    case DS_ARG_SHORT:
+        return (short int) va_arg(*args, int);
+    case DS_ARG_LONG:
+        return va_arg(*args, long int);
+    case DS_ARG_LLONG:
+        return va_arg(*args, long long int);
+    case DS_ARG_INTMAX:
+        return va_arg(*args, intmax_t);
+    case DS_ARG_SIZE:
+        return (ssize_t) va_arg(*args, size_t);
+    case DS_ARG_PTRDIFF:
+        return va_arg(*args, ptrdiff_t);
+    case DS_ARG_INT:
+    default:
+        return va_arg(*args, int);
+    }
+}
+
+/* Fetches an integer argument of type 'arg' from 'args' and returns it,
+ * converted as the unsigned version of that type. */
+static uint64_t
+ds_format_get_unsigned(enum ds_format_arg arg, va_list *args)
+{
+    switch (arg) {
+    case DS_ARG_CHAR:
+        return (unsigned char) va_arg(*args, unsigned int);
+    case DS_ARG_SHORT:
+        return (unsigned short int) va_arg(*args, unsigned int);
+    case DS_ARG_LONG:
+        return va_arg(*args, unsigned long int);
+    case DS_ARG_LLONG:
+        return va_arg(*args, unsigned long long int);
+    case DS_ARG_INTMAX:
+        return va_arg(*args, uintmax_t);
+    case DS_ARG_SIZE:
+        return va_arg(*args, size_t);
+    case DS_ARG_PTRDIFF:
+        return (size_t) va_arg(*args, ptrdiff_t);
+    case DS_ARG_INT:
+    default:
+        return va_arg(*args, unsigned int);
+    }
+}
+
+/* Formats a conversion with ds_put_format(), passing it the 'n_stars' values
+ * in 'stars' followed by 'VALUE'. */
+#define DS_PUT_GENERIC(DS, SPEC, N_STARS, STARS, VALUE)                 \
+    ((N_STARS) == 0 ? ds_put_format(DS, SPEC, VALUE)                    \
+     : (N_STARS) == 1 ? ds_put_format(DS, SPEC, (STARS)[0], VALUE)      \
+     : ds_put_format(DS, SPEC, (STARS)[0], (STARS)[1], VALUE))
+
+static void
+ds_put_generic(ds_t *ds, const struct ds_format *f,
+               const struct ds_format_op *op, va_list *args)
+{
+    const char *spec = &f->text[op->offset];
+    int stars[2] = { 0, 0 };
+
+    for (int i = 0; i < op->n_stars; i++) {
+        stars[i] = va_arg(*args, int);
+    }
+
+    switch (op->arg) {
+    case DS_ARG_CHAR:
+    case DS_ARG_SHORT:
+    case DS_ARG_INT:
+        DS_PUT_GENERIC(ds, spec, op->n_stars, stars, va_arg(*args, int));
+        break;
+    case DS_ARG_LONG:
+        DS_PUT_GENERIC(ds, spec, op->n_stars, stars,
+                       va_arg(*args, long int));
+        break;
+    case DS_ARG_LLONG:
+        DS_PUT_GENERIC(ds, spec, op->n_stars, stars,
+                       va_arg(*args, long long int));
+        break;
+    case DS_ARG_INTMAX:
+        DS_PUT_GENERIC(ds, spec, op->n_stars, stars,
+                       va_arg(*args, intmax_t));
+        break;
+    case DS_ARG_SIZE:
+        DS_PUT_GENERIC(ds, spec, op->n_stars, stars, va_arg(*args, size_t));
+        break;
+    case DS_ARG_PTRDIFF:
+        DS_PUT_GENERIC(ds, spec, op->n_stars, stars,
+                       va_arg(*args, ptrdiff_t));
+        break;
+    case DS_ARG_DOUBLE:
+        DS_PUT_GENERIC(ds, spec, op->n_stars, stars, va_arg(*args, double));
+        break;
+    case DS_ARG_LDOUBLE:
+        DS_PUT_GENERIC(ds, spec, op->n_stars, stars,
+                       va_arg(*args, long double));
+        break;
+    case DS_ARG_POINTER:
+        DS_PUT_GENERIC(ds, spec, op->n_stars, stars,
+                       va_arg(*args, void *));
+        break;
+    case DS_ARG_NONE:
+    default:
+        abort();
+    }
+}
+
+/* Appends to 'ds' the output of the compiled format 'f' with the given
+ * arguments.  The output is exactly the same as that of ds_put_format() with
+ * the format from which 'f' was compiled. */
+void
+ds_put_compiled(ds_t *ds, const struct ds_format *f, ...)
+{
+    va_list args;
+
+    va_start(args, f);
+    ds_put_compiled_valist(ds, f, args);
+    va_end(args);
+}
+
+void
+ds_put_compiled_valist(ds_t *ds, const struct ds_format *f, va_list args_)
+{
+    va_list args;
+
+    if (f->whole) {
+        ds_put_format_valist(ds, f->format, args_);
+        return;
+    }
+
+    va_copy(args, args_);
+    for (size_t i = 0; i < f->n_ops; i++) {
+        const struct ds_format_op *op = &f->ops[i];
+        const char *s;
+
+        switch (op->type) {
+        case DS_OP_LITERAL:
+            ds_put_buffer(ds, &f->text[op->offset], op->length);
+            break;
+
+        case DS_OP_SIGNED:
+            ds_put_i64(ds, ds_format_get_signed(op->arg, &args));
+            break;
+
+        case DS_OP_UNSIGNED:
+            if (op->conversion == 'u') {
+                ds_put_u64(ds, ds_format_get_unsigned(op->arg, &args));
+            } else {
+                ds_put_u64_hex(ds, ds_format_get_unsigned(op->arg, &args),
+                               op->conversion == 'X');
+            }
+            break;
+
+        case DS_OP_STRING:
+            s = va_arg(args, const char *);
+            if (s) {
+                ds_put_cstr(ds, s);
+            } else {
+                ds_put_cstr(ds, "(null)");
+            }
+            break;
+
+        case DS_OP_CHAR:
+            ds_put_char(ds, va_arg(args, int));
+            break;
+
+        case DS_OP_GENERIC:
+            ds_put_generic(ds, f, op, &args);
+            break;
+        }
+    }
+    va_end(args);
+}
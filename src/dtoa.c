@@ -0,0 +1,438 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Conversion of doubles to short decimal strings, using the Grisu2 algorithm
+ * from Florian Loitsch, "Printing Floating-Point Numbers Quickly and
+ * Accurately with Integers", PLDI 2010.  The output always converts back to
+ * exactly the same double.  It is the shortest such output for more than
+ * 99.9% of doubles.  The exceptions are mostly doubles whose shortest form
+ * lies exactly halfway to a neighboring double, which Grisu2 conservatively
+ * avoids at the cost of a few more digits. */
+
+#include "dtoa.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+/* An unnormalized floating-point number f * 2**e. */
+struct diy_fp {
+    uint64_t f;
+    int e;
+};
+
+#define DP_SIGNIFICAND_BITS 52
+#define DP_HIDDEN_BIT (UINT64_C(1) << DP_SIGNIFICAND_BITS)
+#define DP_SIGNIFICAND_MASK (DP_HIDDEN_BIT - 1)
+#define DP_EXPONENT_BIAS (0x3ff + DP_SIGNIFICAND_BITS)
+
+/* Normalized 64-bit approximations of 10**k, rounded to nearest, for k =
+ * -348, -340, ..., 340. */
+static const struct diy_fp cached_powers[] = {
+    { UINT64_C(0xfa8fd5a0081c0288), -1220 },
+    { UINT64_C(0xbaaee17fa23ebf76), -1193 },
+    { UINT64_C(0x8b16fb203055ac76), -1166 },
+    { UINT64_C(0xcf42894a5dce35ea), -1140 },
+    { UINT64_C(0x9a6bb0aa55653b2d), -1113 },
+    { UINT64_C(0xe61acf033d1a45df), -1087 },
+    { UINT64_C(0xab70fe17c79ac6ca), -1060 },
+    { UINT64_C(0xff77b1fcbebcdc4f), -1034 },
+    { UINT64_C(0xbe5691ef416bd60c), -1007 },
+    { UINT64_C(0x8dd01fad907ffc3c), -980 },
+    { UINT64_C(0xd3515c2831559a83), -954 },
+    { UINT64_C(0x9d71ac8fada6c9b5), -927 },
+    { UINT64_C(0xea9c227723ee8bcb), -901 },
+    { UINT64_C(0xaecc49914078536d), -874 },
+    { UINT64_C(0x823c12795db6ce57), -847 },
+    { UINT64_C(0xc21094364dfb5637), -821 },
+    { UINT64_C(0x9096ea6f3848984f), -794 },
+    { UINT64_C(0xd77485cb25823ac7), -768 },
+    { UINT64_C(0xa086cfcd97bf97f4), -741 },
+    { UINT64_C(0xef340a98172aace5), -715 },
+    { UINT64_C(0xb23867fb2a35b28e), -688 },
+    { UINT64_C(0x84c8d4dfd2c63f3b), -661 },
+    { UINT64_C(0xc5dd44271ad3cdba), -635 },
+    { UINT64_C(0x936b9fcebb25c996), -608 },
+    { UINT64_C(0xdbac6c247d62a584), -582 },
+    { UINT64_C(0xa3ab66580d5fdaf6), -555 },
+    { UINT64_C(0xf3e2f893dec3f126), -529 },
+    { UINT64_C(0xb5b5ada8aaff80b8), -502 },
+    { UINT64_C(0x87625f056c7c4a8b), -475 },
+    { UINT64_C(0xc9bcff6034c13053), -449 },
+    { UINT64_C(0x964e858c91ba2655), -422 },
+    { UINT64_C(0xdff9772470297ebd), -396 },
+    { UINT64_C(0xa6dfbd9fb8e5b88f), -369 },
+    { UINT64_C(0xf8a95fcf88747d94), -343 },
+    { UINT64_C(0xb94470938fa89bcf), -316 },
+    { UINT64_C(0x8a08f0f8bf0f156b), -289 },
+    { UINT64_C(0xcdb02555653131b6), -263 },
+    { UINT64_C(0x993fe2c6d07b7fac), -236 },
+    { UINT64_C(0xe45c10c42a2b3b06), -210 },
+    { UINT64_C(0xaa242499697392d3), -183 },
+    { UINT64_C(0xfd87b5f28300ca0e), -157 },
+    { UINT64_C(0xbce5086492111aeb), -130 },
+    { UINT64_C(0x8cbccc096f5088cc), -103 },
+    { UINT64_C(0xd1b71758e219652c), -77 },
+    { UINT64_C(0x9c40000000000000), -50 },
+    { UINT64_C(0xe8d4a51000000000), -24 },
+    { UINT64_C(0xad78ebc5ac620000), 3 },
+    { UINT64_C(0x813f3978f8940984), 30 },
+    { UINT64_C(0xc097ce7bc90715b3), 56 },
+    { UINT64_C(0x8f7e32ce7bea5c70), 83 },
+    { UINT64_C(0xd5d238a4abe98068), 109 },
+    { UINT64_C(0x9f4f2726179a2245), 136 },
+    { UINT64_C(0xed63a231d4c4fb27), 162 },
+    { UINT64_C(0xb0de65388cc8ada8), 189 },
+    { UINT64_C(0x83c7088e1aab65db), 216 },
+    { UINT64_C(0xc45d1df942711d9a), 242 },
+    { UINT64_C(0x924d692ca61be758), 269 },
+    { UINT64_C(0xda01ee641a708dea), 295 },
+    { UINT64_C(0xa26da3999aef774a), 322 },
+    { UINT64_C(0xf209787bb47d6b85), 348 },
+    { UINT64_C(0xb454e4a179dd1877), 375 },
+    { UINT64_C(0x865b86925b9bc5c2), 402 },
+    { UINT64_C(0xc83553c5c8965d3d), 428 },
+    { UINT64_C(0x952ab45cfa97a0b3), 455 },
+    { UINT64_C(0xde469fbd99a05fe3), 481 },
+    { UINT64_C(0xa59bc234db398c25), 508 },
+    { UINT64_C(0xf6c69a72a3989f5c), 534 },
+    { UINT64_C(0xb7dcbf5354e9bece), 561 },
+    { UINT64_C(0x88fcf317f22241e2), 588 },
+    { UINT64_C(0xcc20ce9bd35c78a5), 614 },
+    { UINT64_C(0x98165af37b2153df), 641 },
+    { UINT64_C(0xe2a0b5dc971f303a), 667 },
+    { UINT64_C(0xa8d9d1535ce3b396), 694 },
+    { UINT64_C(0xfb9b7cd9a4a7443c), 720 },
+    { UINT64_C(0xbb764c4ca7a44410), 747 },
+    { UINT64_C(0x8bab8eefb6409c1a), 774 },
+    { UINT64_C(0xd01fef10a657842c), 800 },
+    { UINT64_C(0x9b10a4e5e9913129), 827 },
+    { UINT64_C(0xe7109bfba19c0c9d), 853 },
+    { UINT64_C(0xac2820d9623bf429), 880 },
+    { UINT64_C(0x80444b5e7aa7cf85), 907 },
+    { UINT64_C(0xbf21e44003acdd2d), 933 },
+    { UINT64_C(0x8e679c2f5e44ff8f), 960 },
+    { UINT64_C(0xd433179d9c8cb841), 986 },
+    { UINT64_C(0x9e19db92b4e31ba9), 1013 },
+    { UINT64_C(0xeb96bf6ebadf77d9), 1039 },
+    { UINT64_C(0xaf87023b9bf0ee6b), 1066 },
+};
+
+static const uint64_t pow10_u64[] = {
+    UINT64_C(1),
+    UINT64_C(10),
+    UINT64_C(100),
+    UINT64_C(1000),
+    UINT64_C(10000),
+    UINT64_C(100000),
+    UINT64_C(1000000),
+    UINT64_C(10000000),
+    UINT64_C(100000000),
+    UINT64_C(1000000000),
+    UINT64_C(10000000000),
+    UINT64_C(100000000000),
+    UINT64_C(1000000000000),
+    UINT64_C(10000000000000),
+    UINT64_C(100000000000000),
+    UINT64_C(1000000000000000),
+    UINT64_C(10000000000000000),
+    UINT64_C(100000000000000000),
+    UINT64_C(1000000000000000000),
+    UINT64_C(10000000000000000000),
+};
+
+static struct diy_fp
+diy_fp_from_double(double d)
+{
+    struct diy_fp x;
+    uint64_t bits;
+    int biased_e;
+
+    memcpy(&bits, &d, sizeof bits);
+    biased_e = (bits >> DP_SIGNIFICAND_BITS) & 0x7ff;
+    x.f = bits & DP_SIGNIFICAND_MASK;
+    if (biased_e) {
+        x.f += DP_HIDDEN_BIT;
+        x.e = biased_e - DP_EXPONENT_BIAS;
+    } else {
+        x.e = 1 - DP_EXPONENT_BIAS;
+    }
+    return x;
+}
+
+static struct diy_fp
+diy_fp_normalize(struct diy_fp x)
+{
+    int shift = __builtin_clzll(x.f);
+
+    x.f <<= shift;
+    x.e -= shift;
+    return x;
+}
+
+/* Returns x * y, rounded to 64 bits. */
+static struct diy_fp
+diy_fp_multiply(struct diy_fp x, struct diy_fp y)
+{
+    struct diy_fp r;
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 p = (unsigned __int128) x.f * y.f;
+    uint64_t hi = p >> 64;
+    uint64_t lo = p;
+
+    r.f = hi + (lo >> 63);
+#else
+    const uint64_t M32 = UINT32_MAX;
+    uint64_t a = x.f >> 32, b = x.f & M32;
+    uint64_t c = y.f >> 32, d = y.f & M32;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+
+    tmp += UINT64_C(1) << 31;   /* Round. */
+    r.f = ac + (ad >> 32) + (bc >> 32) + (tmp >> 32);
+#endif
+    r.e = x.e + y.e + 64;
+    return r;
+}
+
+/* Stores in '*minus' and '*plus' the boundaries of the interval of real
+ * numbers that round to 'v', with '*plus' normalized and '*minus' given the
+ * same exponent. */
+static void
+normalized_boundaries(struct diy_fp v, struct diy_fp *minus,
+                      struct diy_fp *plus)
+{
+    struct diy_fp pl, mi;
+
+    pl.f = (v.f << 1) + 1;
+    pl.e = v.e - 1;
+    pl = diy_fp_normalize(pl);
+
+    if (v.f == DP_HIDDEN_BIT) {
+        mi.f = (v.f << 2) - 1;
+        mi.e = v.e - 2;
+    } else {
+        mi.f = (v.f << 1) - 1;
+        mi.e = v.e - 1;
+    }
+    mi.f <<= mi.e - pl.e;
+    mi.e = pl.e;
+
+    *plus = pl;
+    *minus = mi;
+}
+
+/* Returns a cached power of ten c such that multiplying a number with binary
+ * exponent 'e' by c yields a binary exponent in [-60, -32].  Stores in '*k'
+ * the negation of the decimal exponent of c. */
+static struct diy_fp
+get_cached_power(int e, int *k)
+{
+    double dk = (-61 - e) * 0.30102999566398114 + 347;
+    int ik = (int) dk;
+    unsigned int index;
+
+    if (dk - ik > 0.0) {
+        ik++;
+    }
+    index = (ik >> 3) + 1;
+    *k = -(-348 + (int) index * 8);
+    return cached_powers[index];
+}
+
+static void
+grisu_round(char *buffer, int len, uint64_t delta, uint64_t rest,
+            uint64_t ten_kappa, uint64_t wp_w)
+{
+    while (rest < wp_w && delta - rest >= ten_kappa
+           && (rest + ten_kappa < wp_w
+               || wp_w - rest > rest + ten_kappa - wp_w)) {
+        buffer[len - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+static int
+count_decimal_digits32(uint32_t n)
+{
+    int digits = 1;
+
+    while (n >= 10) {
+        n /= 10;
+        digits++;
+    }
+    return digits;
+}
+
+/* Generates into 'buffer' the shortest digits of a number in (mp - delta, mp]
+ * that is as close as possible to 'w', storing the number of digits in
+ * '*len' and adding to '*k' the decimal exponent of the last digit. */
+static void
+digit_gen(struct diy_fp w, struct diy_fp mp, uint64_t delta,
+          char *buffer, int *len, int *k)
+{
+    const struct diy_fp one = { UINT64_C(1) << -mp.e, mp.e };
+    const uint64_t wp_w = mp.f - w.f;
+    uint32_t p1 = mp.f >> -one.e;
+    uint64_t p2 = mp.f & (one.f - 1);
+    int kappa = count_decimal_digits32(p1);
+
+    *len = 0;
+    while (kappa > 0) {
+        uint32_t divisor = pow10_u64[kappa - 1];
+        uint32_t d = p1 / divisor;
+        uint64_t rest;
+
+        p1 %= divisor;
+        if (d || *len) {
+            buffer[(*len)++] = '0' + d;
+        }
+        kappa--;
+
+        rest = ((uint64_t) p1 << -one.e) + p2;
+        if (rest <= delta) {
+            *k += kappa;
+            grisu_round(buffer, *len, delta, rest,
+                        pow10_u64[kappa] << -one.e, wp_w);
+            return;
+        }
+    }
+
+    for (;;) {
+        uint32_t d;
+
+        p2 *= 10;
+        delta *= 10;
+        d = p2 >> -one.e;
+        if (d || *len) {
+            buffer[(*len)++] = '0' + d;
+        }
+        p2 &= one.f - 1;
+        kappa--;
+        if (p2 < delta) {
+            *k += kappa;
+            grisu_round(buffer, *len, delta, p2, one.f,
+                        -kappa < 20 ? wp_w * pow10_u64[-kappa] : 0);
+            return;
+        }
+    }
+}
+
+/* Stores the digits of positive finite 'value' into 'buffer', without a
+ * decimal point, and returns the number of digits.  The value is the digits
+ * times 10**'*k'. */
+static int
+grisu2(double value, char *buffer, int *k)
+{
+    struct diy_fp v = diy_fp_from_double(value);
+    struct diy_fp w_m, w_p, c_mk, w, wp, wm;
+    int len;
+
+    normalized_boundaries(v, &w_m, &w_p);
+    c_mk = get_cached_power(w_p.e, k);
+    w = diy_fp_multiply(diy_fp_normalize(v), c_mk);
+    wp = diy_fp_multiply(w_p, c_mk);
+    wm = diy_fp_multiply(w_m, c_mk);
+    wm.f++;
+    wp.f--;
+    digit_gen(w, wp, wp.f - wm.f, buffer, &len, k);
+    return len;
+}
+
+static char *
+write_exponent(char *p, int e)
+{
+    *p++ = 'e';
+    if (e < 0) {
+        *p++ = '-';
+        e = -e;
+    } else {
+        *p++ = '+';
+    }
+    if (e >= 100) {
+        *p++ = '0' + e / 100;
+        e %= 100;
+        *p++ = '0' + e / 10;
+    } else if (e >= 10) {
+        *p++ = '0' + e / 10;
+    }
+    *p++ = '0' + e % 10;
+    return p;
+}
+
+/* Formats 'value' into 'buffer', which must have room for at least
+ * DTOA_BUFSIZE bytes, as the shortest decimal string (with the exception
+ * noted at the top of this file) that strtod() converts back to exactly
+ * 'value'.  Returns the length of the string, which is not null-terminated.
+ *
+ * The notation follows ECMAScript's Number.prototype.toString(): plain
+ * decimal notation for magnitudes in [1e-6, 1e21), such as "0.1", "1.5", or
+ * "1234", and exponential notation otherwise, such as "1e+21" or
+ * "1.2345e-7".  Negative zero is "-0", and infinities and NaN are "inf",
+ * "-inf", and "nan", as printed by printf(). */
+size_t
+dtoa_shortest(double value, char *buffer)
+{
+    char digits[20];
+    char *p = buffer;
+    int len, k, n;
+
+    if (isnan(value)) {
+        memcpy(buffer, "nan", 3);
+        return 3;
+    }
+    if (signbit(value)) {
+        *p++ = '-';
+        value = -value;
+    }
+    if (isinf(value)) {
+        memcpy(p, "inf", 3);
+        return p + 3 - buffer;
+    } else if (value == 0) {
+        *p++ = '0';
+        return p - buffer;
+    }
+
+    k = 0;
+    len = grisu2(value, digits, &k);
+
+    /* The value is 0.DIGITS * 10**n. */
+    n = len + k;
+    if (len <= n && n <= 21) {
+        memcpy(p, digits, len);
+        memset(p + len, '0', n - len);
+        p += n;
+    } else if (0 < n && n <= 21) {
+        memcpy(p, digits, n);
+        p[n] = '.';
+        memcpy(p + n + 1, digits + n, len - n);
+        p += len + 1;
+    } else if (-6 < n && n <= 0) {
+        *p++ = '0';
+        *p++ = '.';
+        memset(p, '0', -n);
+        p += -n;
+        memcpy(p, digits, len);
+        p += len;
+    } else {
+        *p++ = digits[0];
+        if (len > 1) {
+            *p++ = '.';
+            memcpy(p, digits + 1, len - 1);
+            p += len - 1;
+        }
+        p = write_exponent(p, n - 1);
+    }
+    return p - buffer;
+}
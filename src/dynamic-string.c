@@ -17,12 +17,23 @@
 #include <inttypes.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <assert.h>
+#include <errno.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "openlibc/dynamic-string.h"
 #include "openlibc/util.h"
+#include "dtoa.h"
+#include "simd.h"
 #include "util.h"
 
+#if HAVE_X86_SIMD
+#include <tmmintrin.h>
+#endif
+
 /* Initializes 'ds' as an empty string buffer. */
 void
 ds_init(struct ds *ds)
@@ -30,6 +41,28 @@ ds_init(struct ds *ds)
     ds->string = NULL;
     ds->length = 0;
     ds->allocated = 0;
+    ds->stub = NULL;
+}
+
+/* Initializes 'ds' as an empty string buffer that uses the 'stub_size' bytes
+ * in 'stub', which must be at least 1, until it needs more space.  See the
+ * description of struct ds for details. */
+void
+ds_init_stub(struct ds *ds, char *stub, size_t stub_size)
+{
+    assert(stub_size > 0);
+    ds->string = stub;
+    ds->string[0] = '\0';
+    ds->length = 0;
+    ds->allocated = stub_size - 1;
+    ds->stub = stub;
+}
+
+/* Returns true if 'ds' is using its stub. */
+static bool
+ds_in_stub(const struct ds *ds)
+{
+    return ds->stub && ds->string == ds->stub;
 }
 
 /* Sets 'ds''s length to 0, effectively clearing any existing content.  Does
@@ -60,7 +93,13 @@ ds_reserve(struct ds *ds, size_t min_length)
     if (min_length > ds->allocated || !ds->string) {
         ds->allocated += MAX(min_length, ds->allocated);
         ds->allocated = MAX(8, ds->allocated);
-        ds->string = xrealloc(ds->string, ds->allocated + 1);
+        if (ds_in_stub(ds)) {
+            char *string = xmalloc(ds->allocated + 1);
+            memcpy(string, ds->string, ds->length);
+            ds->string = string;
+        } else {
+            ds->string = xrealloc(ds->string, ds->allocated + 1);
+        }
     }
 }
 
@@ -133,6 +172,96 @@ ds_put_and_free_cstr(struct ds *ds, char *s)
     free(s);
 }
 
+static const char hex_digits[] = "0123456789abcdef";
+
+/* "00", "01", ..., "99", for formatting two decimal digits at a time. */
+static const char digit_pairs[201] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/* Formats 'x' in decimal into the bytes just before 'end' and returns the
+ * first byte written.  Writes at most 20 bytes. */
+static char *
+format_u64(uint64_t x, char *end)
+{
+    char *p = end;
+
+    while (x >= 100) {
+        unsigned int pair = x % 100;
+
+        x /= 100;
+        p -= 2;
+        memcpy(p, &digit_pairs[pair * 2], 2);
+    }
+    if (x >= 10) {
+        p -= 2;
+        memcpy(p, &digit_pairs[x * 2], 2);
+    } else {
+        *--p = '0' + x;
+    }
+    return p;
+}
+
+/* Appends 'x' to 'ds' in decimal, as with the PRIu64 printf() format. */
+void
+ds_put_u64(struct ds *ds, uint64_t x)
+{
+    char buf[20];
+    char *end = buf + sizeof buf;
+    char *start = format_u64(x, end);
+
+    ds_put_buffer(ds, start, end - start);
+}
+
+/* Appends 'x' to 'ds' in decimal, as with the PRId64 printf() format. */
+void
+ds_put_i64(struct ds *ds, int64_t x)
+{
+    char buf[21];
+    char *end = buf + sizeof buf;
+    char *start;
+
+    if (x < 0) {
+        start = format_u64(UINT64_C(0) - (uint64_t) x, end);
+        *--start = '-';
+    } else {
+        start = format_u64(x, end);
+    }
+    ds_put_buffer(ds, start, end - start);
+}
+
+/* Appends 'x' to 'ds' in hexadecimal without a "0x" prefix, as with the
+ * PRIx64 printf() format, or PRIX64 if 'upper' is true. */
+void
+ds_put_u64_hex(struct ds *ds, uint64_t x, bool upper)
+{
+    const char *digits = upper ? "0123456789ABCDEF" : hex_digits;
+    char buf[16];
+    char *end = buf + sizeof buf;
+    char *p = end;
+
+    do {
+        *--p = digits[x & 0xf];
+        x >>= 4;
+    } while (x);
+    ds_put_buffer(ds, p, end - p);
+}
+
+/* Appends 'x' to 'ds' as a short decimal string that round-trips exactly,
+ * e.g. "0.1", "1234", or "1e+100".  The string is the shortest possible for
+ * all but about 0.04% of values.  See dtoa_shortest() for details of the
+ * notation. */
+void
+ds_put_double(struct ds *ds, double x)
+{
+    char buf[DTOA_BUFSIZE];
+
+    ds_put_buffer(ds, buf, dtoa_shortest(x, buf));
+}
+
 void
 ds_put_format(struct ds *ds, const char *format, ...)
 {
@@ -147,11 +276,19 @@ void
 ds_put_format_valist(struct ds *ds, const char *format, va_list args_)
 {
     va_list args;
-    size_t available;
+    size_t available, predicted;
     int needed;
 
+    /* Make sure there is room for the output of most formats, so that usually
+     * only a single pass through vsnprintf() is needed.  If there is already
+     * enough room, 'ds' is left alone, so a stub buffer stays in use. */
+    predicted = strlen(format) + 64;
+    if (!ds->string || ds->allocated - ds->length < predicted) {
+        ds_reserve(ds, ds->length + predicted);
+    }
+
     va_copy(args, args_);
-    available = ds->string ? ds->allocated - ds->length + 1 : 0;
+    available = ds->allocated - ds->length + 1;
     needed = vsnprintf(&ds->string[ds->length], available, format, args);
     va_end(args);
 
@@ -170,34 +307,181 @@ ds_put_format_valist(struct ds *ds, const char *format, va_list args_)
     }
 }
 
+/* Escaping.
+ *
+ * ds_put_printable() and ds_put_json_string() copy runs of bytes that need no
+ * escaping in bulk.  With SSE2, they find the end of each run 16 bytes at a
+ * time. */
+
+static inline bool
+needs_printable_escape(unsigned char c)
+{
+    return c < 0x20 || c > 0x7e || c == '\\' || c == '"';
+}
+
+static inline bool
+needs_json_escape(unsigned char c)
+{
+    return c < 0x20 || c == '\\' || c == '"';
+}
+
+#ifdef __SSE2__
+/* Returns a bitmap with bit 'i' set if 'p[i]' is a control character (less
+ * than 0x20), a backslash, or a double quote, or, if 'high' is true, greater
+ * than 0x7e, for 'i' in [0, 16). */
+static inline unsigned int
+escape_mask(const char *p, bool high)
+{
+    __m128i x = _mm_loadu_si128((const __m128i *) p);
+    __m128i ctrl = _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(0x1f)), x);
+    __m128i quote = _mm_cmpeq_epi8(x, _mm_set1_epi8('"'));
+    __m128i backslash = _mm_cmpeq_epi8(x, _mm_set1_epi8('\\'));
+    __m128i mask = _mm_or_si128(ctrl, _mm_or_si128(quote, backslash));
+
+    if (high) {
+        __m128i hi = _mm_cmpeq_epi8(_mm_max_epu8(x, _mm_set1_epi8(0x7f)), x);
+        mask = _mm_or_si128(mask, hi);
+    }
+    return _mm_movemask_epi8(mask);
+}
+#endif
+
+/* Returns the number of bytes at the start of the 'n' bytes in 's' that need
+ * no escaping by ds_put_printable() (if 'printable' is true) or
+ * ds_put_json_string() (if 'printable' is false). */
+static inline size_t
+scan_unescaped(const char *s, size_t n, bool printable)
+{
+    size_t i = 0;
+
+#ifdef __SSE2__
+    for (; i + 16 <= n; i += 16) {
+        unsigned int mask = escape_mask(&s[i], printable);
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        unsigned char c = s[i];
+        if (printable ? needs_printable_escape(c) : needs_json_escape(c)) {
+            break;
+        }
+    }
+    return i;
+}
+
+/* Appends the 'n' bytes in 's' to 'ds', replacing each byte that is not
+ * printable ASCII, and each backslash and double quote, by a backslash
+ * followed by the byte's value as 3 octal digits. */
 void
 ds_put_printable(struct ds *ds, const char *s, size_t n)
 {
     ds_reserve(ds, ds->length + n);
-    while (n-- > 0) {
-        unsigned char c = *s++;
-        if (c < 0x20 || c > 0x7e || c == '\\' || c == '"') {
-            ds_put_format(ds, "\\%03o", (int) c);
-        } else {
-            ds_put_char(ds, c);
+    while (n > 0) {
+        size_t run = scan_unescaped(s, n, true);
+
+        ds_put_buffer(ds, s, run);
+        s += run;
+        n -= run;
+        if (n) {
+            unsigned char c = *s++;
+            char *p = ds_put_uninit(ds, 4);
+
+            p[0] = '\\';
+            p[1] = '0' + (c >> 6);
+            p[2] = '0' + ((c >> 3) & 7);
+            p[3] = '0' + (c & 7);
+            n--;
+        }
+    }
+}
+
+/* For each byte that ds_put_json_string() escapes, the character that follows
+ * the backslash in its escape sequence, where 'u' means a \u00XX escape. */
+static const char json_escapes[256] = {
+    ['\0'] = 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+    ['\b'] = 'b', ['\t'] = 't', ['\n'] = 'n', ['\v'] = 'u',
+    ['\f'] = 'f', ['\r'] = 'r', [0x0e] = 'u', 'u',
+    [0x10] = 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+    [0x18] = 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+    ['"'] = '"', ['\\'] = '\\',
+};
+
+/* Appends the 'n' bytes in 's' to 'ds' as a JSON string, that is, enclosed in
+ * double quotes, with double quotes, backslashes, and control characters
+ * escaped.  Other bytes, including those of multibyte UTF-8 characters, are
+ * copied as is. */
+void
+ds_put_json_string(struct ds *ds, const char *s, size_t n)
+{
+    ds_reserve(ds, ds->length + n + 2);
+    ds_put_char(ds, '"');
+    while (n > 0) {
+        size_t run = scan_unescaped(s, n, false);
+
+        ds_put_buffer(ds, s, run);
+        s += run;
+        n -= run;
+        if (n) {
+            unsigned char c = *s++;
+            char escape = json_escapes[c];
+
+            if (escape == 'u') {
+                char *p = ds_put_uninit(ds, 6);
+
+                memcpy(p, "\\u00", 4);
+                p[4] = hex_digits[c >> 4];
+                p[5] = hex_digits[c & 15];
+            } else {
+                char *p = ds_put_uninit(ds, 2);
+
+                p[0] = '\\';
+                p[1] = escape;
+            }
+            n--;
         }
     }
+    ds_put_char(ds, '"');
 }
 
+/* Reads a line from 'file' into 'ds', clearing anything initially in 'ds'.
+ * The new-line character that ends the line, if any, is not stored.
+ *
+ * Returns 0 if successful, EOF if no characters were read because 'file' was
+ * at end of file or an error occurred.
+ *
+ * getline() reads directly into the buffer of 'ds', which lets the C library
+ * search its own buffer for the new-line character instead of returning
+ * characters one at a time.  For reading large files, see also
+ * line-reader.h. */
 int
 ds_get_line(struct ds *ds, FILE *file)
 {
+    size_t size;
+    ssize_t n;
+
     ds_clear(ds);
-    for (;;) {
-        int c = getc(file);
-        if (c == EOF) {
-            return ds->length ? 0 : EOF;
-        } else if (c == '\n') {
-            return 0;
-        } else {
-            ds_put_char(ds, c);
+    if (ds_in_stub(ds)) {
+        /* getline() needs a heap buffer. */
+        ds->string = NULL;
+        ds->allocated = 0;
+    }
+    size = ds->string ? ds->allocated + 1 : 0;
+    n = getline(&ds->string, &size, file);
+    if (ds->string) {
+        ds->allocated = size - 1;
+    }
+    if (n <= 0) {
+        if (ds->string) {
+            ds->string[0] = '\0';
         }
+        return EOF;
     }
+
+    ds->length = n;
+    ds_chomp(ds, '\n');
+    return 0;
 }
 
 /* Reads a line from 'file' into 'ds', clearing anything initially in 'ds'.
@@ -281,6 +565,174 @@ ds_get_test_line(struct ds *ds, FILE *file)
     }
 }
 
+/* Appends to 'ds' the result of formatting 'tm' according to the 'n' bytes
+ * of strftime() format that begin at 'format'. */
+static void
+ds_put_strftime__(struct ds *ds, const char *format, size_t n,
+                  const struct tm *tm)
+{
+    char fmt_stub[64];
+    struct ds fmt;
+    size_t avail;
+
+    if (!n) {
+        return;
+    }
+    ds_init_stub(&fmt, fmt_stub, sizeof fmt_stub);
+    ds_put_buffer(&fmt, format, n);
+
+    avail = 64;
+    for (;;) {
+        size_t used;
+
+        ds_reserve(ds, ds->length + avail);
+        avail = ds->allocated - ds->length + 1;
+        used = strftime(&ds->string[ds->length], avail, ds_cstr(&fmt), tm);
+        if (used) {
+            ds->length += used;
+            break;
+        } else if (avail > 1024 + 64 * n) {
+            /* strftime() also returns 0 for output that is really empty. */
+            break;
+        }
+        avail *= 2;
+    }
+    ds_destroy(&fmt);
+}
+
+/* Appends to 'ds' the result of formatting 'tm' and 'msec' according to
+ * 'format', in which "%#" stands for 'msec' as 3 digits.  Stores the offsets
+ * of the first 'max_msecs' of those digits, relative to the start of the
+ * output, in 'msec_ofs', and returns the number of occurrences of "%#". */
+static size_t
+ds_put_strftime_msec__(struct ds *ds, const char *format, const struct tm *tm,
+                       int msec, size_t msec_ofs[], size_t max_msecs)
+{
+    size_t start = ds->length;
+    const char *segment = format;
+    const char *p = format;
+    size_t n_msecs = 0;
+
+    while (*p) {
+        if (p[0] != '%' || !p[1]) {
+            p++;
+        } else if (p[1] != '#') {
+            p += 2;
+        } else {
+            char *digits;
+
+            ds_put_strftime__(ds, segment, p - segment, tm);
+            if (n_msecs < max_msecs) {
+                msec_ofs[n_msecs] = ds->length - start;
+            }
+            n_msecs++;
+
+            digits = ds_put_uninit(ds, 3);
+            digits[0] = '0' + msec / 100;
+            digits[1] = '0' + msec / 10 % 10;
+            digits[2] = '0' + msec % 10;
+
+            p += 2;
+            segment = p;
+        }
+    }
+    ds_put_strftime__(ds, segment, p - segment, tm);
+    return n_msecs;
+}
+
+/* Per-thread cache of output from ds_put_strftime_msec(), so that logging
+ * many messages in the same second runs localtime_r() and strftime() only
+ * once for each of them.  A cached entry is reused only within the same
+ * second, so the only part of its output that can differ is the
+ * milliseconds. */
+#define STRFTIME_CACHE_SIZE 4
+#define STRFTIME_CACHE_MSECS 4
+
+struct strftime_cache_entry {
+    long long int sec;          /* Time, in seconds since the epoch. */
+    bool utc;                   /* UTC or local time? */
+    char format[64];            /* Format string, or empty if unused. */
+    char output[128];           /* Formatted output. */
+    size_t length;              /* Length of 'output'. */
+    size_t msec_ofs[STRFTIME_CACHE_MSECS]; /* Offsets of "%#" in 'output'. */
+    size_t n_msecs;             /* Number of elements in 'msec_ofs'. */
+};
+
+static _Thread_local struct strftime_cache_entry
+    strftime_cache[STRFTIME_CACHE_SIZE];
+static _Thread_local unsigned int strftime_cache_next;
+
+/* Appends to 'ds' the time 'when', in milliseconds since the epoch, formatted
+ * according to 'format' as with strftime(), as UTC if 'utc' is true,
+ * otherwise as local time.  "%#" in 'format' expands to the milliseconds,
+ * as exactly 3 digits.
+ *
+ * Results are cached per thread for the current second, so that calls for
+ * nearby times only need to copy the cached output and rewrite the
+ * milliseconds. */
+void
+ds_put_strftime_msec(struct ds *ds, const char *format, long long int when,
+                     bool utc)
+{
+    struct strftime_cache_entry *e;
+    long long int sec = when / 1000;
+    int msec = when % 1000;
+    struct ds tmp;
+    struct tm tm;
+    time_t now;
+    size_t i;
+
+    if (msec < 0) {
+        msec += 1000;
+        sec--;
+    }
+
+    for (i = 0; i < STRFTIME_CACHE_SIZE; i++) {
+        e = &strftime_cache[i];
+        if (e->sec == sec && e->utc == utc && e->format[0]
+            && !strcmp(e->format, format)) {
+            char *p = ds_put_uninit(ds, e->length);
+
+            memcpy(p, e->output, e->length);
+            for (size_t j = 0; j < e->n_msecs; j++) {
+                char *digits = &p[e->msec_ofs[j]];
+
+                digits[0] = '0' + msec / 100;
+                digits[1] = '0' + msec / 10 % 10;
+                digits[2] = '0' + msec % 10;
+            }
+            return;
+        }
+    }
+
+    now = sec;
+    if (!(utc ? gmtime_r(&now, &tm) : localtime_r(&now, &tm))) {
+        memset(&tm, 0, sizeof tm);
+    }
+
+    if (strlen(format) >= sizeof e->format) {
+        ds_put_strftime_msec__(ds, format, &tm, msec, NULL, 0);
+        return;
+    }
+
+    /* Format into a new cache entry, then copy the output to 'ds'.  If the
+     * output doesn't fit in the entry, leave the entry unused. */
+    e = &strftime_cache[strftime_cache_next++ % STRFTIME_CACHE_SIZE];
+    ds_init_stub(&tmp, e->output, sizeof e->output);
+    e->n_msecs = ds_put_strftime_msec__(&tmp, format, &tm, msec, e->msec_ofs,
+                                        STRFTIME_CACHE_MSECS);
+    ds_put_buffer(ds, tmp.string, tmp.length);
+    if (tmp.string == e->output && e->n_msecs <= STRFTIME_CACHE_MSECS) {
+        e->sec = sec;
+        e->utc = utc;
+        strcpy(e->format, format);
+        e->length = tmp.length;
+    } else {
+        e->format[0] = '\0';
+    }
+    ds_destroy(&tmp);
+}
+
 char *
 ds_cstr(struct ds *ds)
 {
@@ -299,11 +751,15 @@ ds_cstr_ro(const struct ds *ds)
 
 /* Returns a null-terminated string representing the current contents of 'ds',
  * which the caller is expected to free with free(), then clears the contents
- * of 'ds'. */
+ * of 'ds'.  If 'ds' was using its stub, returns a copy of the content on the
+ * heap.  Afterward, 'ds' no longer has a stub. */
 char *
 ds_steal_cstr(struct ds *ds)
 {
     char *s = ds_cstr(ds);
+    if (ds_in_stub(ds)) {
+        s = xmemdup0(s, ds->length);
+    }
     ds_init(ds);
     return s;
 }
@@ -311,10 +767,13 @@ ds_steal_cstr(struct ds *ds)
 void
 ds_destroy(struct ds *ds)
 {
-    free(ds->string);
+    if (!ds_in_stub(ds)) {
+        free(ds->string);
+    }
 }
 
-/* Swaps the content of 'a' and 'b'. */
+/* Swaps the content of 'a' and 'b'.  Stubs move along with the content that
+ * uses them. */
 void
 ds_swap(struct ds *a, struct ds *b)
 {
@@ -323,42 +782,218 @@ ds_swap(struct ds *a, struct ds *b)
     *b = temp;
 }
 
+/* Hex encoding and decoding.  With SSSE3, hex_encode() looks up 16 nibbles
+ * at a time with pshufb and hex_decode() converts 32 digits at a time; the
+ * scalar versions look up 2 digits or 1 byte at a time in tables. */
+/* Each byte in 'hex_values' is the value of the hex digit with that character
+ * code, or 0xff if it is not a hex digit. */
+static const uint8_t hex_values[256] = {
+#define X16 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, \
+            0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+    X16, X16, X16,
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 10, 11, 12, 13, 14, 15, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, X16,
+    0xff, 10, 11, 12, 13, 14, 15, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, X16,
+    X16, X16, X16, X16, X16, X16, X16, X16
+#undef X16
+};
+
+#if HAVE_X86_SIMD
+/* Encodes the 'n' bytes in 'src', where 'n' is a multiple of 16, as 2 * 'n'
+ * lowercase hex digits in 'dst'. */
+static void TARGET_SSSE3
+hex_encode_ssse3(char *dst, const uint8_t *src, size_t n)
+{
+    const __m128i lut = _mm_loadu_si128((const __m128i *) hex_digits);
+    const __m128i mask = _mm_set1_epi8(0x0f);
+
+    for (; n; n -= 16, src += 16, dst += 32) {
+        __m128i x = _mm_loadu_si128((const __m128i *) src);
+        __m128i hi = _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(x, 4),
+                                                         mask));
+        __m128i lo = _mm_shuffle_epi8(lut, _mm_and_si128(x, mask));
+
+        _mm_storeu_si128((__m128i *) dst, _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i *) (dst + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+}
+
+/* Returns the values of the 16 hex digits in 'x' and sets '*bad' to nonzero
+ * if any of them is not a hex digit. */
+static inline __m128i TARGET_SSSE3
+hex_values_ssse3(__m128i x, __m128i *bad)
+{
+    __m128i digit = _mm_sub_epi8(x, _mm_set1_epi8('0'));
+    __m128i letter = _mm_sub_epi8(_mm_or_si128(x, _mm_set1_epi8(0x20)),
+                                  _mm_set1_epi8('a'));
+    __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)),
+                                      digit);
+    __m128i is_letter = _mm_cmpeq_epi8(_mm_min_epu8(letter,
+                                                    _mm_set1_epi8(5)),
+                                       letter);
+
+    *bad = _mm_or_si128(*bad, _mm_andnot_si128(_mm_or_si128(is_digit,
+                                                            is_letter),
+                                               _mm_set1_epi8(-1)));
+    return _mm_or_si128(_mm_and_si128(is_digit, digit),
+                        _mm_and_si128(is_letter,
+                                      _mm_add_epi8(letter,
+                                                   _mm_set1_epi8(10))));
+}
+
+/* Decodes the 2 * 'n' hex digits in 'src', where 'n' is a multiple of 16,
+ * into 'n' bytes in 'dst'.  Returns false if 'src' contains a character that
+ * is not a hex digit, otherwise true. */
+static bool TARGET_SSSE3
+hex_decode_ssse3(uint8_t *dst, const char *src, size_t n)
+{
+    const __m128i weights = _mm_set1_epi16(0x0110);
+
+    for (; n; n -= 16, src += 32, dst += 16) {
+        __m128i bad = _mm_setzero_si128();
+        __m128i a = hex_values_ssse3(
+            _mm_loadu_si128((const __m128i *) src), &bad);
+        __m128i b = hex_values_ssse3(
+            _mm_loadu_si128((const __m128i *) (src + 16)), &bad);
+
+        if (_mm_movemask_epi8(bad)) {
+            return false;
+        }
+        /* Each pair of nibbles becomes 16 * high + low. */
+        _mm_storeu_si128((__m128i *) dst,
+                         _mm_packus_epi16(_mm_maddubs_epi16(a, weights),
+                                          _mm_maddubs_epi16(b, weights)));
+    }
+    return true;
+}
+#endif
+
+/* Encodes the 'n' bytes in 'src' as 2 * 'n' lowercase hex digits in 'dst'. */
+static void
+hex_encode(char *dst, const uint8_t *src, size_t n)
+{
+#if HAVE_X86_SIMD
+    if (n >= 16 && cpu_has_ssse3()) {
+        size_t n_simd = ROUND_DOWN(n, 16);
+
+        hex_encode_ssse3(dst, src, n_simd);
+        dst += 2 * n_simd;
+        src += n_simd;
+        n -= n_simd;
+    }
+#endif
+    for (; n; n--) {
+        *dst++ = hex_digits[*src >> 4];
+        *dst++ = hex_digits[*src++ & 0xf];
+    }
+}
+
+/* Decodes the 2 * 'n' hex digits in 'src' into 'n' bytes in 'dst'.  Returns
+ * false if 'src' contains a character that is not a hex digit, otherwise
+ * true. */
+static bool
+hex_decode(uint8_t *dst, const char *src, size_t n)
+{
+#if HAVE_X86_SIMD
+    if (n >= 16 && cpu_has_ssse3()) {
+        size_t n_simd = ROUND_DOWN(n, 16);
+
+        if (!hex_decode_ssse3(dst, src, n_simd)) {
+            return false;
+        }
+        dst += n_simd;
+        src += 2 * n_simd;
+        n -= n_simd;
+    }
+#endif
+    for (; n; n--, src += 2) {
+        uint8_t hi = hex_values[(unsigned char) src[0]];
+        uint8_t lo = hex_values[(unsigned char) src[1]];
+
+        if ((hi | lo) == 0xff) {
+            return false;
+        }
+        *dst++ = (hi << 4) | lo;
+    }
+    return true;
+}
+
+/* Appends the 'size' bytes in 'buf' to 'ds' as a hexadecimal number, with a
+ * "0x" prefix and without leading zeros, e.g. "0x1234" for { 0, 0x12, 0x34 }.
+ * Appends "0" if all of the bytes are zero. */
 void
 ds_put_hex(struct ds *ds, const void *buf_, size_t size)
 {
     const uint8_t *buf = buf_;
-    bool printed = false;
-    int i;
-
-    for (i = 0; i < size; i++) {
-        uint8_t val = buf[i];
-        if (val || printed) {
-            if (!printed) {
-                ds_put_format(ds, "0x%"PRIx8, val);
-            } else {
-                ds_put_format(ds, "%02"PRIx8, val);
-            }
-            printed = true;
-        }
+    size_t i;
+
+    for (i = 0; i < size && !buf[i]; i++) {
+        continue;
     }
-    if (!printed) {
+    if (i >= size) {
         ds_put_char(ds, '0');
+        return;
+    }
+
+    ds_put_cstr(ds, "0x");
+    if (buf[i] >= 0x10) {
+        ds_put_char(ds, hex_digits[buf[i] >> 4]);
+    }
+    ds_put_char(ds, hex_digits[buf[i] & 0xf]);
+    i++;
+    ds_put_hex_string(ds, &buf[i], size - i);
+}
+
+/* Appends the 'size' bytes in 'buf' to 'ds' as 2 * 'size' lowercase hex
+ * digits, without any prefix or separators, as commonly used for digests. */
+void
+ds_put_hex_string(struct ds *ds, const void *buf, size_t size)
+{
+    hex_encode(ds_put_uninit(ds, 2 * size), buf, size);
+}
+
+/* Decodes the 'n' hex digits in 'hex', which may be uppercase or lowercase,
+ * and appends the bytes that they represent to 'ds'.  Returns 0 if
+ * successful.  Returns EINVAL, without modifying 'ds', if 'n' is odd or 'hex'
+ * contains any character that is not a hex digit. */
+int
+ds_put_hex_decode(struct ds *ds, const char *hex, size_t n)
+{
+    size_t length = ds->length;
+
+    if (n % 2) {
+        return EINVAL;
+    }
+    if (!hex_decode((uint8_t *) ds_put_uninit(ds, n / 2), hex, n / 2)) {
+        ds_truncate(ds, length);
+        return EINVAL;
     }
+    return 0;
 }
 
 /* Writes the 'size' bytes in 'buf' to 'string' as hex bytes arranged 16 per
  * line.  Numeric offsets are also included, starting at 'ofs' for the first
  * byte in 'buf'.  If 'ascii' is true then the corresponding ASCII characters
- * are also rendered alongside. */
+ * are also rendered alongside.
+ *
+ * Each line is formatted in a local buffer and appended all at once. */
 void
 ds_put_hex_dump(struct ds *ds, const void *buf_, size_t size,
                 uintptr_t ofs, bool ascii)
 {
     const uint8_t *buf = buf_;
-    const size_t per_line = 16; /* Maximum bytes per line. */
+    enum { per_line = 16 };     /* Maximum bytes per line. */
 
     while (size > 0) {
+        /* Offset (at most 16 digits), 2 spaces, 3 characters per byte,
+         * 2 bars, 1 character per byte, and a new-line. */
+        char line[16 + 2 + 3 * per_line + 2 + per_line + 1];
+        char hex[2 * per_line];
         size_t start, end, n;
+        uintmax_t line_ofs;
+        char *p = line;
         size_t i;
 
         /* Number of bytes on this line. */
@@ -368,33 +1003,45 @@ ds_put_hex_dump(struct ds *ds, const void *buf_, size_t size,
             end = start + size;
         n = end - start;
 
-        /* Print line. */
-        ds_put_format(ds, "%08"PRIxMAX"  ",
-                      (uintmax_t) ROUND_DOWN(ofs, per_line));
-        for (i = 0; i < start; i++) {
-            ds_put_format(ds, "   ");
+        /* Offset, in at least 8 hex digits. */
+        line_ofs = ROUND_DOWN(ofs, per_line);
+        for (i = 16; i > 8 && !(line_ofs >> (4 * (i - 1))); i--) {
+            continue;
+        }
+        while (i-- > 0) {
+            *p++ = hex_digits[(line_ofs >> (4 * i)) & 0xf];
         }
-        for (; i < end; i++) {
-            ds_put_format(ds, "%02x%c",
-                          buf[i - start], i == per_line / 2 - 1? '-' : ' ');
+        *p++ = ' ';
+        *p++ = ' ';
+
+        /* Hex bytes. */
+        hex_encode(hex, buf, n);
+        memset(p, ' ', 3 * start);
+        p += 3 * start;
+        for (i = start; i < end; i++) {
+            *p++ = hex[2 * (i - start)];
+            *p++ = hex[2 * (i - start) + 1];
+            *p++ = i == per_line / 2 - 1 ? '-' : ' ';
         }
+
         if (ascii) {
-            for (; i < per_line; i++)
-                ds_put_format(ds, "   ");
-            ds_put_format(ds, "|");
-            for (i = 0; i < start; i++)
-                ds_put_format(ds, " ");
-            for (; i < end; i++) {
+            memset(p, ' ', 3 * (per_line - end));
+            p += 3 * (per_line - end);
+            *p++ = '|';
+            memset(p, ' ', start);
+            p += start;
+            for (i = start; i < end; i++) {
                 int c = buf[i - start];
-                ds_put_char(ds, c >= 32 && c < 127 ? c : '.');
+                *p++ = c >= 32 && c < 127 ? c : '.';
             }
-            for (; i < per_line; i++)
-                ds_put_format(ds, " ");
-            ds_put_format(ds, "|");
-        } else {
-            ds_chomp(ds, ' ');
+            memset(p, ' ', per_line - end);
+            p += per_line - end;
+            *p++ = '|';
+        } else if (p[-1] == ' ') {
+            p--;
         }
-        ds_put_format(ds, "\n");
+        *p++ = '\n';
+        ds_put_buffer(ds, line, p - line);
 
         ofs += n;
         buf += n;
@@ -419,11 +1066,15 @@ ds_chomp(struct ds *ds, int c)
     }
 }
 
+/* Initializes 'dst' as a copy of 'source'.  The copy is always on the heap,
+ * even if 'source' is using a stub. */
 void
 ds_clone(struct ds *dst, struct ds *source)
 {
     dst->length = source->length;
     dst->allocated = dst->length;
     dst->string = xmalloc(dst->allocated + 1);
-    memcpy(dst->string, source->string, dst->allocated + 1);
+    nullable_memcpy(dst->string, source->string, dst->length);
+    dst->string[dst->length] = '\0';
+    dst->stub = NULL;
 }
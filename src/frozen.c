@@ -0,0 +1,224 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "openlibc/frozen.h"
+
+#include <string.h>
+
+#include "openlibc/hash.h"
+#include "util.h"
+
+/* Initializes 'table' with the 'n' names in 'names', which must be sorted and
+ * whose hashes, as computed by hash_bytes() with basis 0, are in 'hashes'. */
+static void
+frozen_table_init(struct frozen_table *table, const char **names,
+                  const uint32_t *hashes, size_t n)
+{
+    size_t blob_size, i;
+
+    blob_size = 0;
+    for (i = 0; i < n; i++) {
+        blob_size += strlen(names[i]) + 1;
+    }
+    if (blob_size > UINT32_MAX || n >= UINT32_MAX) {
+        out_of_memory();
+    }
+
+    /* Copy the names into the blob. */
+    table->blob = xmalloc(blob_size);
+    table->offsets = xmalloc((n + 1) * sizeof *table->offsets);
+    table->n = n;
+    blob_size = 0;
+    for (i = 0; i < n; i++) {
+        size_t length = strlen(names[i]);
+
+        table->offsets[i] = blob_size;
+        memcpy(&table->blob[blob_size], names[i], length + 1);
+        blob_size += length + 1;
+    }
+    table->offsets[n] = blob_size;
+
+    /* Build the index, keeping it no more than half full. */
+    table->mask = 1;
+    while (table->mask < 2 * n) {
+        table->mask = 2 * table->mask + 1;
+    }
+    table->slots = xmalloc((table->mask + 1) * sizeof *table->slots);
+    memset(table->slots, 0, (table->mask + 1) * sizeof *table->slots);
+    for (i = 0; i < n; i++) {
+        size_t j = hashes[i] & table->mask;
+
+        while (table->slots[j].index) {
+            j = (j + 1) & table->mask;
+        }
+        table->slots[j].hash = hashes[i];
+        table->slots[j].index = i + 1;
+    }
+}
+
+static void
+frozen_table_destroy(struct frozen_table *table)
+{
+    free(table->blob);
+    free(table->offsets);
+    free(table->slots);
+}
+
+/* Returns the index of the name in 'table' that is the 'length' bytes
+ * starting at 'name', or SIZE_MAX if there is no such name. */
+static size_t
+frozen_table_find(const struct frozen_table *table,
+                  const char *name, size_t length)
+{
+    uint32_t hash = hash_bytes(name, length, 0);
+
+    for (size_t j = hash & table->mask; ; j = (j + 1) & table->mask) {
+        const struct frozen_slot *slot = &table->slots[j];
+
+        if (!slot->index) {
+            return SIZE_MAX;
+        } else if (slot->hash == hash) {
+            size_t i = slot->index - 1;
+            size_t ofs = table->offsets[i];
+
+            if (table->offsets[i + 1] - ofs - 1 == length
+                && !memcmp(&table->blob[ofs], name, length)) {
+                return i;
+            }
+        }
+    }
+}
+
+/* Initializes 'fs' as a frozen copy of 'set'. */
+void
+sset_freeze(frozen_sset_t *fs, const sset_t *set)
+{
+    size_t n = sset_count(set);
+    const char **names = sset_sort(set);
+    uint32_t *hashes = xmalloc(n * sizeof *hashes);
+
+    for (size_t i = 0; i < n; i++) {
+        hashes[i] = SSET_NODE_FROM_NAME(names[i])->hmap_node.hash;
+    }
+    frozen_table_init(&fs->table, names, hashes, n);
+    free(hashes);
+    free(names);
+}
+
+/* Initializes 'set' as a new sset that contains the strings in 'fs'. */
+void
+sset_thaw(sset_t *set, const frozen_sset_t *fs)
+{
+    sset_init(set);
+    hmap_reserve(&set->map, frozen_sset_count(fs));
+    for (size_t i = 0; i < frozen_sset_count(fs); i++) {
+        sset_add(set, frozen_sset_name(fs, i));
+    }
+}
+
+/* Frees the memory that 'fs' uses. */
+void
+frozen_sset_destroy(frozen_sset_t *fs)
+{
+    if (fs) {
+        frozen_table_destroy(&fs->table);
+    }
+}
+
+/* Returns true if 'fs' contains 'name', false otherwise. */
+bool
+frozen_sset_contains(const frozen_sset_t *fs, const char *name)
+{
+    return frozen_sset_contains_len(fs, name, strlen(name));
+}
+
+/* Returns true if 'fs' contains the 'length' bytes starting at 'name' as one
+ * of its strings, false otherwise. */
+bool
+frozen_sset_contains_len(const frozen_sset_t *fs,
+                         const char *name, size_t length)
+{
+    return frozen_table_find(&fs->table, name, length) != SIZE_MAX;
+}
+
+/* Initializes 'fm' as a frozen copy of 'sh'.  The data pointers are copied,
+ * not the data that they point to.
+ *
+ * If 'sh' contains duplicate names, so does 'fm', and searches for a
+ * duplicated name return an arbitrary one of them. */
+void
+smap_freeze(frozen_smap_t *fm, const smap_t *sh)
+{
+    size_t n = smap_count(sh);
+    const struct smap_node **nodes = smap_sort(sh);
+    const char **names = xmalloc(n * sizeof *names);
+    uint32_t *hashes = xmalloc(n * sizeof *hashes);
+
+    fm->data = xmalloc(n * sizeof *fm->data);
+    for (size_t i = 0; i < n; i++) {
+        names[i] = nodes[i]->name;
+        hashes[i] = nodes[i]->node.hash;
+        fm->data[i] = nodes[i]->data;
+    }
+    frozen_table_init(&fm->table, names, hashes, n);
+    free(hashes);
+    free(names);
+    free(nodes);
+}
+
+/* Initializes 'sh' as a new smap that contains the mappings in 'fm'. */
+void
+smap_thaw(smap_t *sh, const frozen_smap_t *fm)
+{
+    smap_init(sh);
+    hmap_reserve(&sh->map, frozen_smap_count(fm));
+    for (size_t i = 0; i < frozen_smap_count(fm); i++) {
+        smap_add(sh, frozen_smap_name(fm, i), frozen_smap_data(fm, i));
+    }
+}
+
+/* Frees the memory that 'fm' uses.  Does not free the data values. */
+void
+frozen_smap_destroy(frozen_smap_t *fm)
+{
+    if (fm) {
+        frozen_table_destroy(&fm->table);
+        free(fm->data);
+    }
+}
+
+/* Returns the index of the mapping in 'fm' whose name is 'name', or SIZE_MAX
+ * if there is none. */
+size_t
+frozen_smap_find(const frozen_smap_t *fm, const char *name)
+{
+    return frozen_table_find(&fm->table, name, strlen(name));
+}
+
+/* Returns the index of the mapping in 'fm' whose name is the 'length' bytes
+ * starting at 'name', or SIZE_MAX if there is none. */
+size_t
+frozen_smap_find_len(const frozen_smap_t *fm, const char *name, size_t length)
+{
+    return frozen_table_find(&fm->table, name, length);
+}
+
+/* Returns the data for 'name' in 'fm', or a null pointer if 'fm' does not
+ * contain 'name'. */
+void *
+frozen_smap_find_data(const frozen_smap_t *fm, const char *name)
+{
+    size_t i = frozen_smap_find(fm, name);
+    return i != SIZE_MAX ? fm->data[i] : NULL;
+}
@@ -0,0 +1,80 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SIMD_H
+#define SIMD_H 1
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Support for instruction set extensions beyond the compiler's baseline.
+ *
+ * The library is normally built for baseline x86-64, which includes SSE2 but
+ * not SSSE3 or later.  Code that benefits from a later extension goes in a
+ * function marked with TARGET_SSSE3, which lets the compiler use SSSE3
+ * intrinsics in that function only, and callers check cpu_has_ssse3() at
+ * runtime before calling it.  HAVE_X86_SIMD is 1 if this is possible with
+ * the current compiler and target, otherwise 0.
+ *
+ * Usage example:
+ *
+ *     #if HAVE_X86_SIMD
+ *     #include <tmmintrin.h>
+ *
+ *     static void TARGET_SSSE3
+ *     frob_ssse3(...)
+ *     {
+ *         ...
+ *     }
+ *     #endif
+ *
+ *     void
+ *     frob(...)
+ *     {
+ *     #if HAVE_X86_SIMD
+ *         if (cpu_has_ssse3()) {
+ *             frob_ssse3(...);
+ *             return;
+ *         }
+ *     #endif
+ *         ...portable code...
+ *     }
+ */
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) \
+    && defined(__SSE2__)
+#define HAVE_X86_SIMD 1
+#define TARGET_SSSE3 __attribute__((__target__("ssse3")))
+
+/* Returns true if the CPU supports SSSE3. */
+static inline bool
+cpu_has_ssse3(void)
+{
+#ifdef __SSSE3__
+    return true;
+#else
+    return __builtin_cpu_supports("ssse3");
+#endif
+}
+#else
+#define HAVE_X86_SIMD 0
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* simd.h */
@@ -0,0 +1,264 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "openlibc/iochain.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "openlibc/util.h"
+#include "util.h"
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+/* References to less than this many bytes are copied instead, since a copy
+ * of a small buffer is cheaper than an extra iovec for the kernel to walk. */
+#define IOCHAIN_COPY_MAX 128
+
+/* A segment of an iochain.  Owned data can't be referenced by pointer
+ * because 'buf' may be reallocated as it grows, so it is referenced by
+ * offset instead. */
+struct iochain_seg {
+    const char *data;           /* Borrowed data, or null if owned. */
+    size_t ofs;                 /* Offset into 'buf', if owned. */
+    size_t len;                 /* Number of bytes. */
+};
+
+/* Initializes 'chain' as an empty iochain. */
+void
+iochain_init(struct iochain *chain)
+{
+    *chain = (struct iochain) IOCHAIN_INITIALIZER;
+}
+
+/* Removes all of the segments from 'chain', without freeing the memory that
+ * it has allocated, so that it can be reused for more output. */
+void
+iochain_clear(struct iochain *chain)
+{
+    ds_clear(&chain->buf);
+    chain->n_segs = chain->first = 0;
+    chain->length = 0;
+}
+
+/* Frees the memory allocated by 'chain'.  Does not free borrowed data. */
+void
+iochain_destroy(struct iochain *chain)
+{
+    if (chain) {
+        ds_destroy(&chain->buf);
+        free(chain->segs);
+        free(chain->iov);
+    }
+}
+
+static const char *
+iochain_seg_data(const struct iochain *chain, const struct iochain_seg *seg)
+{
+    return seg->data ? seg->data : &chain->buf.string[seg->ofs];
+}
+
+static struct iochain_seg *
+iochain_add_seg(struct iochain *chain)
+{
+    if (chain->n_segs >= chain->allocated_segs) {
+        chain->segs = x2nrealloc(chain->segs, &chain->allocated_segs,
+                                 sizeof *chain->segs);
+    }
+    return &chain->segs[chain->n_segs++];
+}
+
+/* Records that the 'n' bytes at offset 'ofs' in 'chain->buf', which the
+ * caller just appended, are the next output in 'chain'. */
+static void
+iochain_add_owned(struct iochain *chain, size_t ofs, size_t n)
+{
+    struct iochain_seg *last;
+
+    if (!n) {
+        return;
+    }
+    chain->length += n;
+
+    last = chain->n_segs > chain->first ? &chain->segs[chain->n_segs - 1]
+                                        : NULL;
+    if (last && !last->data && last->ofs + last->len == ofs) {
+        last->len += n;
+    } else {
+        struct iochain_seg *seg = iochain_add_seg(chain);
+        seg->data = NULL;
+        seg->ofs = ofs;
+        seg->len = n;
+    }
+}
+
+/* Appends a copy of the 'n' bytes starting at 'data' to 'chain'. */
+void
+iochain_put_buffer(struct iochain *chain, const void *data, size_t n)
+{
+    size_t ofs = chain->buf.length;
+
+    ds_put_buffer(&chain->buf, data, n);
+    iochain_add_owned(chain, ofs, n);
+}
+
+/* Appends a copy of 's' to 'chain'. */
+void
+iochain_put_cstr(struct iochain *chain, const char *s)
+{
+    iochain_put_buffer(chain, s, strlen(s));
+}
+
+/* Appends output formatted as with printf() to 'chain'. */
+void
+iochain_put_format(struct iochain *chain, const char *format, ...)
+{
+    size_t ofs = chain->buf.length;
+    va_list args;
+
+    va_start(args, format);
+    ds_put_format_valist(&chain->buf, format, args);
+    va_end(args);
+    iochain_add_owned(chain, ofs, chain->buf.length - ofs);
+}
+
+/* Appends a reference to the 'n' bytes starting at 'data' to 'chain',
+ * without copying them.  The caller must not modify or free 'data' until
+ * the reference has been consumed, or 'chain' cleared or destroyed.
+ *
+ * Small references are copied anyway, since copying them is cheaper than
+ * writing an extra segment. */
+void
+iochain_put_ref(struct iochain *chain, const void *data, size_t n)
+{
+    struct iochain_seg *seg;
+
+    if (n < IOCHAIN_COPY_MAX) {
+        iochain_put_buffer(chain, data, n);
+        return;
+    }
+
+    seg = iochain_add_seg(chain);
+    seg->data = data;
+    seg->ofs = 0;
+    seg->len = n;
+    chain->length += n;
+}
+
+/* Fills in 'chain->iov' to describe up to 'max' of the unconsumed segments
+ * of 'chain' and returns the number filled in. */
+static size_t
+iochain_fill_iov(struct iochain *chain, size_t max)
+{
+    size_t n = MIN(chain->n_segs - chain->first, max);
+    size_t i;
+
+    if (n > chain->allocated_iov) {
+        free(chain->iov);
+        chain->allocated_iov = MIN(chain->allocated_segs, max);
+        chain->iov = xmalloc(chain->allocated_iov * sizeof *chain->iov);
+    }
+    for (i = 0; i < n; i++) {
+        const struct iochain_seg *seg = &chain->segs[chain->first + i];
+
+        chain->iov[i].iov_base = CONST_CAST(char *,
+                                            iochain_seg_data(chain, seg));
+        chain->iov[i].iov_len = seg->len;
+    }
+    return n;
+}
+
+/* Returns an array of iovecs that describes the unconsumed contents of
+ * 'chain' and stores the number of elements in it in '*n_iov'.  The array is
+ * owned by 'chain' and remains valid only until 'chain' is next modified. */
+const struct iovec *
+iochain_to_iovec(struct iochain *chain, size_t *n_iov)
+{
+    *n_iov = iochain_fill_iov(chain, SIZE_MAX);
+    return chain->iov;
+}
+
+/* Drops the first 'n' bytes from 'chain', typically because they have been
+ * written.  'n' must not exceed iochain_length(chain). */
+void
+iochain_consume(struct iochain *chain, size_t n)
+{
+    assert(n <= chain->length);
+    chain->length -= n;
+    while (n) {
+        struct iochain_seg *seg = &chain->segs[chain->first];
+
+        if (n < seg->len) {
+            if (seg->data) {
+                seg->data += n;
+            } else {
+                seg->ofs += n;
+            }
+            seg->len -= n;
+            break;
+        }
+        n -= seg->len;
+        chain->first++;
+    }
+
+    if (!chain->length) {
+        /* Reuse the buffer and the segment array from the beginning. */
+        iochain_clear(chain);
+    }
+}
+
+/* Appends the unconsumed contents of 'chain' to 'ds'. */
+void
+iochain_flatten(const struct iochain *chain, ds_t *ds)
+{
+    char *p = ds_put_uninit(ds, chain->length);
+    size_t i;
+
+    for (i = chain->first; i < chain->n_segs; i++) {
+        const struct iochain_seg *seg = &chain->segs[i];
+
+        memcpy(p, iochain_seg_data(chain, seg), seg->len);
+        p += seg->len;
+    }
+}
+
+/* Writes the contents of 'chain' to 'fd' with writev(), in as many calls as
+ * needed, and consumes what was written.  Returns 0 if the entire chain was
+ * written, otherwise a positive errno value.  If 'fd' is nonblocking and
+ * cannot accept all of the data, returns EAGAIN; the unwritten data remains
+ * in 'chain' for a later call. */
+int
+iochain_writev(struct iochain *chain, int fd)
+{
+    while (chain->length) {
+        size_t n_iov = iochain_fill_iov(chain, IOV_MAX);
+        ssize_t retval = writev(fd, chain->iov, n_iov);
+
+        if (retval > 0) {
+            iochain_consume(chain, retval);
+        } else if (retval < 0 && errno != EINTR) {
+            return errno == EWOULDBLOCK ? EAGAIN : errno;
+        } else if (!retval) {
+            return EIO;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,155 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "openlibc/line-reader.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "util.h"
+
+/* Initial size of the buffer.  The buffer grows if a line is longer. */
+#define LINE_READER_BUFSIZE (256 * 1024)
+
+struct line_reader {
+    int fd;                     /* File descriptor to read; not owned. */
+    char *buf;                  /* Buffer. */
+    size_t size;                /* Bytes allocated for 'buf'. */
+    size_t start;               /* Start of the next line in 'buf'. */
+    size_t scanned;             /* 'buf' up to here has no new-lines. */
+    size_t end;                 /* End of data in 'buf'. */
+    bool eof;                   /* True if read() reported end of file. */
+};
+
+/* Creates and returns a new line reader that reads from 'fd'.  The caller
+ * retains ownership of 'fd' and must keep it open as long as the line reader
+ * is in use. */
+struct line_reader *
+line_reader_create(int fd)
+{
+    struct line_reader *r = xmalloc(sizeof *r);
+
+    r->fd = fd;
+    r->buf = xmalloc(LINE_READER_BUFSIZE);
+    r->size = LINE_READER_BUFSIZE;
+    r->start = r->scanned = r->end = 0;
+    r->eof = false;
+    return r;
+}
+
+/* Frees 'r', which may be null.  Does not close its file descriptor. */
+void
+line_reader_destroy(struct line_reader *r)
+{
+    if (r) {
+        free(r->buf);
+        free(r);
+    }
+}
+
+/* Makes room in 'r''s buffer for more input, then reads more input into it.
+ * Returns 0 if successful (including at end of file), otherwise a positive
+ * errno value. */
+static int
+line_reader_fill(struct line_reader *r)
+{
+    ssize_t n;
+
+    if (r->start > 0) {
+        /* Move the partial line to the start of the buffer. */
+        memmove(r->buf, &r->buf[r->start], r->end - r->start);
+        r->scanned -= r->start;
+        r->end -= r->start;
+        r->start = 0;
+    }
+    if (r->end == r->size) {
+        /* The partial line fills the buffer. */
+        r->buf = x2nrealloc(r->buf, &r->size, 1);
+    }
+
+    do {
+        n = read(r->fd, &r->buf[r->end], r->size - r->end);
+    } while (n < 0 && errno == EINTR);
+
+    if (n < 0) {
+        return errno;
+    } else if (n == 0) {
+        r->eof = true;
+    } else {
+        r->end += n;
+    }
+    return 0;
+}
+
+/* Reads the next line from 'r' and stores a view of it in '*line', without
+ * the new-line character that ends it, if any.  The view remains valid until
+ * the next call to a function on 'r'.
+ *
+ * Returns 0 if successful, EOF at end of file, or a positive errno value if a
+ * read error occurred. */
+int
+line_reader_next(struct line_reader *r, strview_t *line)
+{
+    for (;;) {
+        const char *nl = memchr(&r->buf[r->scanned], '\n',
+                                r->end - r->scanned);
+        int error;
+
+        if (nl) {
+            line->string = &r->buf[r->start];
+            line->length = nl - line->string;
+            r->start = r->scanned = nl + 1 - r->buf;
+            return 0;
+        }
+        r->scanned = r->end;
+
+        if (r->eof) {
+            if (r->start == r->end) {
+                return EOF;
+            }
+
+            /* The file does not end in a new-line. */
+            line->string = &r->buf[r->start];
+            line->length = r->end - r->start;
+            r->start = r->end;
+            return 0;
+        }
+
+        error = line_reader_fill(r);
+        if (error) {
+            return error;
+        }
+    }
+}
+
+/* Reads the next line from 'r' into 'ds', like ds_get_line(), clearing
+ * anything initially in 'ds'.
+ *
+ * Returns 0 if successful, EOF at end of file, or a positive errno value if a
+ * read error occurred. */
+int
+line_reader_get_line(struct line_reader *r, ds_t *ds)
+{
+    strview_t line;
+    int error;
+
+    ds_clear(ds);
+    error = line_reader_next(r, &line);
+    if (!error) {
+        ds_put_buffer(ds, line.string, line.length);
+    }
+    return error;
+}
@@ -0,0 +1,114 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "openlibc/list.h"
+
+/* Merges 'a' and 'b', which are sorted, null-terminated lists linked through
+ * their 'next' members, into a single sorted list and returns it.  Elements
+ * of 'a' come first among elements that compare equal. */
+static struct olc_list_t *
+olc_list_merge(struct olc_list_t *a, struct olc_list_t *b,
+               int (*compare)(const struct olc_list_t *,
+                              const struct olc_list_t *, void *),
+               void *aux)
+{
+    struct olc_list_t head;
+    struct olc_list_t *tail = &head;
+
+    for (;;) {
+        if (compare(a, b, aux) <= 0) {
+            tail = tail->next = a;
+            a = a->next;
+            if (!a) {
+                tail->next = b;
+                return head.next;
+            }
+        } else {
+            tail = tail->next = b;
+            b = b->next;
+            if (!b) {
+                tail->next = a;
+                return head.next;
+            }
+        }
+    }
+}
+
+/* Sorts 'list' in place according to 'compare', which is called with two
+ * list elements and 'aux' and returns a negative, zero, or positive value
+ * as the first element should sort before, equal to, or after the second.
+ * The sort is stable.
+ *
+ * This is a natural merge sort: it cuts 'list' into runs of elements that
+ * are already in order, then merges the runs pairwise the way a binary
+ * counter carries, keeping at most one pending run of each size.  This
+ * takes O(n log n) time in general and about n comparisons when 'list' is
+ * already sorted or nearly so, and it relinks the elements without
+ * allocating memory. */
+void
+olc_list_sort(struct olc_list_t *list,
+              int (*compare)(const struct olc_list_t *a,
+                             const struct olc_list_t *b, void *aux),
+              void *aux)
+{
+    struct olc_list_t *bins[64];
+    struct olc_list_t *rest, *run, *e, *prev;
+    size_t i, n_bins;
+
+    if (olc_list_is_short(list)) {
+        return;
+    }
+
+    list->prev->next = NULL;
+    rest = list->next;
+    n_bins = 0;
+    while (rest) {
+        /* Cut off the next run. */
+        run = rest;
+        while (rest->next && compare(rest, rest->next, aux) <= 0) {
+            rest = rest->next;
+        }
+        e = rest->next;
+        rest->next = NULL;
+        rest = e;
+
+        /* Merge it with the pending runs.  Each pending run holds earlier
+         * elements than 'run', so it goes first for stability. */
+        for (i = 0; i < n_bins && bins[i]; i++) {
+            run = olc_list_merge(bins[i], run, compare, aux);
+            bins[i] = NULL;
+        }
+        if (i == n_bins) {
+            n_bins++;
+        }
+        bins[i] = run;
+    }
+
+    run = NULL;
+    for (i = 0; i < n_bins; i++) {
+        if (bins[i]) {
+            run = run ? olc_list_merge(bins[i], run, compare, aux) : bins[i];
+        }
+    }
+
+    /* Restore the 'prev' pointers. */
+    list->next = run;
+    prev = list;
+    for (e = run; e; e = e->next) {
+        e->prev = prev;
+        prev = e;
+    }
+    prev->next = list;
+    list->prev = prev;
+}
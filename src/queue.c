@@ -36,36 +36,107 @@ olc_queue_middle(olc_queue_t *queue)
 }
 
 
-/* the stable insertion sort */
+/*
+ * merge the null-terminated sorted runs "a" and "b", linked through "next",
+ * taking elements from "a" first when they compare equal
+ */
+
+static olc_queue_t *
+olc_queue_merge(olc_queue_t *a, olc_queue_t *b,
+    olc_int_t (*cmp)(const olc_queue_t *, const olc_queue_t *))
+{
+    olc_queue_t   head, *tail;
+
+    tail = &head;
+
+    for ( ;; ) {
+        if (cmp(a, b) <= 0) {
+            tail->next = a;
+            tail = a;
+            a = a->next;
+
+            if (a == NULL) {
+                tail->next = b;
+                return head.next;
+            }
+
+        } else {
+            tail->next = b;
+            tail = b;
+            b = b->next;
+
+            if (b == NULL) {
+                tail->next = a;
+                return head.next;
+            }
+        }
+    }
+}
+
+
+/*
+ * the stable natural merge sort: the queue is cut into its nondecreasing
+ * runs, which are merged like the digits of a binary counter, so that a
+ * sorted or nearly sorted queue takes about n comparisons and any queue
+ * takes O(n log n); the nodes are relinked in place without allocation
+ */
 
 void
 olc_queue_sort(olc_queue_t *queue,
     olc_int_t (*cmp)(const olc_queue_t *, const olc_queue_t *))
 {
-    olc_queue_t  *q, *prev, *next;
+    olc_uint_t    i, n;
+    olc_queue_t  *bins[64], *list, *run, *q, *prev;
 
-    q = olc_queue_head(queue);
-
-    if (q == olc_queue_last(queue)) {
+    if (olc_queue_head(queue) == olc_queue_last(queue)) {
         return;
     }
 
-    for (q = olc_queue_next(q); q != olc_queue_sentinel(queue); q = next) {
+    olc_queue_last(queue)->next = NULL;
+    list = olc_queue_head(queue);
+    n = 0;
+
+    while (list) {
+        run = list;
 
-        prev = olc_queue_prev(q);
-        next = olc_queue_next(q);
+        while (list->next && cmp(list, list->next) <= 0) {
+            list = list->next;
+        }
 
-        olc_queue_remove(q);
+        q = list->next;
+        list->next = NULL;
+        list = q;
 
-        do {
-            if (cmp(prev, q) <= 0) {
-                break;
-            }
+        for (i = 0; i < n && bins[i]; i++) {
+            run = olc_queue_merge(bins[i], run, cmp);
+            bins[i] = NULL;
+        }
+
+        if (i == n) {
+            n++;
+        }
+
+        bins[i] = run;
+    }
+
+    run = NULL;
 
-            prev = olc_queue_prev(prev);
+    for (i = 0; i < n; i++) {
+        if (bins[i]) {
+            run = run ? olc_queue_merge(bins[i], run, cmp) : bins[i];
+        }
+    }
 
-        } while (prev != olc_queue_sentinel(queue));
+    /* restore the prev links */
 
-        olc_queue_insert_after(prev, q);
+    queue->next = run;
+    prev = queue;
+
+    for (q = run; q; q = q->next) {
+        q->prev = prev;
+        prev = q;
     }
+
+    prev->next = queue;
+    queue->prev = prev;
 }
@@ -0,0 +1,129 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "openlibc/segvec.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "util.h"
+
+/* Default maximum size of a chunk, in bytes. */
+#define SEGVEC_CHUNK_BYTES 16384
+
+/* Initializes 'sv' as an empty segvec of elements of 'elem_size' bytes each,
+ * stored 'chunk_size' elements to a chunk, rounded up to a power of 2.  If
+ * 'chunk_size' is 0, chooses a chunk size of about 16 kB. */
+void
+segvec_init(struct segvec *sv, size_t elem_size, size_t chunk_size)
+{
+    assert(elem_size > 0);
+
+    sv->chunks = NULL;
+    sv->n_chunks = sv->allocated_chunks = 0;
+    sv->n = 0;
+    sv->elem_size = elem_size;
+
+    sv->chunk_shift = 0;
+    if (!chunk_size) {
+        while (elem_size << (sv->chunk_shift + 1) <= SEGVEC_CHUNK_BYTES) {
+            sv->chunk_shift++;
+        }
+    } else {
+        while (((size_t) 1 << sv->chunk_shift) < chunk_size) {
+            sv->chunk_shift++;
+        }
+    }
+    if (elem_size > SIZE_MAX >> sv->chunk_shift) {
+        out_of_memory();
+    }
+}
+
+/* Frees all of the memory owned by 'sv'. */
+void
+segvec_destroy(struct segvec *sv)
+{
+    if (sv) {
+        size_t i;
+
+        for (i = 0; i < sv->n_chunks; i++) {
+            free(sv->chunks[i]);
+        }
+        free(sv->chunks);
+    }
+}
+
+/* Removes all of the elements from 'sv', keeping its chunks for reuse. */
+void
+segvec_clear(struct segvec *sv)
+{
+    sv->n = 0;
+}
+
+/* Adds one more chunk to 'sv'. */
+static void
+segvec_add_chunk(struct segvec *sv)
+{
+    if (sv->n_chunks >= sv->allocated_chunks) {
+        sv->chunks = x2nrealloc(sv->chunks, &sv->allocated_chunks,
+                                sizeof *sv->chunks);
+    }
+    sv->chunks[sv->n_chunks++] = xmalloc(sv->elem_size << sv->chunk_shift);
+}
+
+/* Ensures that 'sv' can hold at least 'n' elements without allocating any
+ * more memory. */
+void
+segvec_reserve(struct segvec *sv, size_t n)
+{
+    size_t n_chunks = (n >> sv->chunk_shift)
+                      + ((n & (((size_t) 1 << sv->chunk_shift) - 1)) != 0);
+
+    if (n_chunks > sv->allocated_chunks) {
+        sv->chunks = xrealloc(sv->chunks, n_chunks * sizeof *sv->chunks);
+        sv->allocated_chunks = n_chunks;
+    }
+    while (sv->n_chunks < n_chunks) {
+        segvec_add_chunk(sv);
+    }
+}
+
+/* Appends a new, uninitialized element to 'sv' and returns a pointer to it.
+ * The pointer remains valid until the element is popped or 'sv' is cleared
+ * or destroyed. */
+void *
+segvec_push(struct segvec *sv)
+{
+    if (sv->n >= sv->n_chunks << sv->chunk_shift) {
+        segvec_add_chunk(sv);
+    }
+    return segvec_at(sv, sv->n++);
+}
+
+/* Appends a copy of the element at 'elem' to 'sv' and returns a pointer to
+ * the new element. */
+void *
+segvec_push_copy(struct segvec *sv, const void *elem)
+{
+    return memcpy(segvec_push(sv), elem, sv->elem_size);
+}
+
+/* Removes the last element from 'sv', which must not be empty.  Its chunk is
+ * kept for reuse. */
+void
+segvec_pop(struct segvec *sv)
+{
+    assert(sv->n > 0);
+    sv->n--;
+}
@@ -19,6 +19,7 @@
 #include <assert.h>
 
 #include "openlibc/hash.h"
+#include "openlibc/string-sort.h"
 #include "util.h"
 
 static size_t hash_name(const char *, size_t length);
@@ -28,13 +29,16 @@ static struct simap_node *simap_find__(const simap_t *,
 static struct simap_node *simap_add_nocopy__(simap_t *,
                                              char *name, unsigned int data,
                                              size_t hash);
-static int compare_nodes_by_name(const void *a_, const void *b_);
+static void simap_set_data__(simap_t *, struct simap_node *,
+                             unsigned int data);
+static void simap_remove__(simap_t *, struct simap_node *);
 
 /* Initializes 'simap' as an empty string-to-integer map. */
 void
 simap_init(simap_t *simap)
 {
     hmap_init(&simap->map);
+    simap->fingerprint = 0;
 }
 
 /* Frees all the data that 'simap' contains. */
@@ -51,7 +55,11 @@ simap_destroy(simap_t *simap)
 void
 simap_swap(simap_t *a, simap_t *b)
 {
+    uint32_t fingerprint = a->fingerprint;
+
     hmap_swap(&a->map, &b->map);
+    a->fingerprint = b->fingerprint;
+    b->fingerprint = fingerprint;
 }
 
 /* Adjusts 'simap' so that it is still valid after it has been moved around in
@@ -73,6 +81,7 @@ simap_clear(simap_t *simap)
         free(node->name);
         free(node);
     }
+    simap->fingerprint = 0;
 }
 
 /* Returns true if 'simap' contains no mappings, false if it contains at least
@@ -104,7 +113,7 @@ simap_put(simap_t *simap, const char *name, unsigned int data)
 
     node = simap_find__(simap, name, length, hash);
     if (node) {
-        node->data = data;
+        simap_set_data__(simap, node, data);
         return false;
     } else {
         simap_add_nocopy__(simap, xmemdup0(name, length), data, hash);
@@ -130,7 +139,7 @@ simap_increase(simap_t *simap, const char *name, unsigned int amt)
 
         node = simap_find__(simap, name, length, hash);
         if (node) {
-            node->data += amt;
+            simap_set_data__(simap, node, node->data + amt);
         } else {
             node = simap_add_nocopy__(simap, xmemdup0(name, length),
                                       amt, hash);
@@ -145,7 +154,7 @@ simap_increase(simap_t *simap, const char *name, unsigned int amt)
 void
 simap_delete(simap_t *simap, struct simap_node *node)
 {
-    hmap_remove(&simap->map, &node->node);
+    simap_remove__(simap, node);
     free(node->name);
     free(node);
 }
@@ -220,18 +229,23 @@ simap_sort(const simap_t *simap)
         }
         assert(i == n);
 
-        qsort(nodes, n, sizeof *nodes, compare_nodes_by_name);
+        string_sort_indirect((const void **) nodes, n,
+                             offsetof(struct simap_node, name));
 
         return nodes;
     }
 }
 
 /* Returns true if the two maps are equal, meaning that they have the same set
- * of key-value pairs, otherwise false. */
+ * of key-value pairs, otherwise false.
+ *
+ * Maps that differ in size or fingerprint are rejected in O(1) time.  Maps
+ * that pass both checks are compared in full. */
 bool
 simap_equal(const simap_t *a, const simap_t *b)
 {
-    if (simap_count(a) != simap_count(b)) {
+    if (simap_count(a) != simap_count(b)
+        || a->fingerprint != b->fingerprint) {
         return false;
     }
 
@@ -245,17 +259,12 @@ simap_equal(const simap_t *a, const simap_t *b)
     return true;
 }
 
+/* Returns a hash of the contents of 'simap' that does not depend on the order
+ * in which mappings were added.  Runs in O(1) time. */
 uint32_t
 simap_hash(const simap_t *simap)
 {
-    uint32_t hash = 0;
-
-    const struct simap_node *node;
-    SIMAP_FOR_EACH (node, simap) {
-        hash ^= hash_int(node->data,
-                         hash_name(node->name, strlen(node->name)));
-    }
-    return hash;
+    return simap->fingerprint;
 }
 
 static size_t
@@ -264,6 +273,28 @@ hash_name(const char *name, size_t length)
     return hash_bytes(name, length, 0);
 }
 
+/* Returns the contribution of 'node' to its simap's fingerprint. */
+static uint32_t
+simap_node_hash(const struct simap_node *node)
+{
+    return hash_int(node->data, node->node.hash);
+}
+
+static void
+simap_set_data__(simap_t *simap, struct simap_node *node, unsigned int data)
+{
+    simap->fingerprint ^= simap_node_hash(node);
+    node->data = data;
+    simap->fingerprint ^= simap_node_hash(node);
+}
+
+static void
+simap_remove__(simap_t *simap, struct simap_node *node)
+{
+    hmap_remove(&simap->map, &node->node);
+    simap->fingerprint ^= simap_node_hash(node);
+}
+
 static struct simap_node *
 simap_find__(const simap_t *simap, const char *name, size_t name_len,
              size_t hash)
@@ -286,13 +317,6 @@ simap_add_nocopy__(simap_t *simap, char *name, unsigned int data,
     node->name = name;
     node->data = data;
     hmap_insert(&simap->map, &node->node, hash);
+    simap->fingerprint ^= simap_node_hash(node);
     return node;
 }
-
-static int
-compare_nodes_by_name(const void *a_, const void *b_)
-{
-    const struct simap_node *const *a = a_;
-    const struct simap_node *const *b = b_;
-    return strcmp((*a)->name, (*b)->name);
-}
@@ -19,6 +19,7 @@
 #include <assert.h>
 
 #include "openlibc/hash.h"
+#include "openlibc/string-sort.h"
 #include "util.h"
 
 static struct smap_node *smap_find__(const smap_t *,
@@ -35,6 +36,8 @@ void
 smap_init(smap_t *sh)
 {
     hmap_init(&sh->map);
+    sh->fingerprint = 0;
+    sh->filter = NULL;
 }
 
 void
@@ -42,6 +45,7 @@ smap_destroy(smap_t *sh)
 {
     if (sh) {
         smap_clear(sh);
+        smap_disable_filter(sh);
         hmap_destroy(&sh->map);
     }
 }
@@ -52,6 +56,7 @@ smap_destroy_free_data(smap_t *sh)
 {
     if (sh) {
         smap_clear_free_data(sh);
+        smap_disable_filter(sh);
         hmap_destroy(&sh->map);
     }
 }
@@ -59,7 +64,14 @@ smap_destroy_free_data(smap_t *sh)
 void
 smap_swap(smap_t *a, smap_t *b)
 {
+    uint32_t fingerprint = a->fingerprint;
+    struct bloom *filter = a->filter;
+
     hmap_swap(&a->map, &b->map);
+    a->fingerprint = b->fingerprint;
+    b->fingerprint = fingerprint;
+    a->filter = b->filter;
+    b->filter = filter;
 }
 
 void
@@ -68,6 +80,42 @@ smap_moved(smap_t *sh)
     hmap_moved(&sh->map);
 }
 
+/* Initializes 'sh->filter' with room for twice the current number of nodes in
+ * 'sh' and adds all of their names to it. */
+static void
+smap_init_filter__(smap_t *sh)
+{
+    struct smap_node *node;
+
+    bloom_init(sh->filter, 2 * smap_count(sh));
+    SMAP_FOR_EACH (node, sh) {
+        bloom_add(sh->filter, node->node.hash);
+    }
+}
+
+/* Attaches a Bloom filter to 'sh', if it does not already have one, so that
+ * searches for names that are not in 'sh' usually fail after reading a single
+ * cache line.  Works like sset_enable_filter(). */
+void
+smap_enable_filter(smap_t *sh)
+{
+    if (!sh->filter) {
+        sh->filter = xmalloc(sizeof *sh->filter);
+        smap_init_filter__(sh);
+    }
+}
+
+/* Removes and frees the Bloom filter attached to 'sh', if any. */
+void
+smap_disable_filter(smap_t *sh)
+{
+    if (sh->filter) {
+        bloom_destroy(sh->filter);
+        free(sh->filter);
+        sh->filter = NULL;
+    }
+}
+
 void
 smap_clear(smap_t *sh)
 {
@@ -78,6 +126,10 @@ smap_clear(smap_t *sh)
         free(node->name);
         free(node);
     }
+    sh->fingerprint = 0;
+    if (sh->filter) {
+        bloom_clear(sh->filter);
+    }
 }
 
 /* Like shash_clear(), but also free() each node's 'data'. */
@@ -92,6 +144,10 @@ smap_clear_free_data(smap_t *sh)
         free(node->name);
         free(node);
     }
+    sh->fingerprint = 0;
+    if (sh->filter) {
+        bloom_clear(sh->filter);
+    }
 }
 
 bool
@@ -113,6 +169,15 @@ smap_add_nocopy__(smap_t *sh, char *name, const void *data, size_t hash)
     node->name = name;
     node->data = CONST_CAST(void *, data);
     hmap_insert(&sh->map, &node->node, hash);
+    sh->fingerprint += hash;
+    if (sh->filter) {
+        if (bloom_is_full(sh->filter)) {
+            bloom_destroy(sh->filter);
+            smap_init_filter__(sh);
+        } else {
+            bloom_add(sh->filter, hash);
+        }
+    }
     return node;
 }
 
@@ -129,14 +194,14 @@ smap_add_nocopy(smap_t *sh, char *name, const void *data)
 struct smap_node *
 smap_add(smap_t *sh, const char *name, const void *data)
 {
-    return shash_add_nocopy(sh, strdup(name), data);
+    return smap_add_nocopy(sh, strdup(name), data);
 }
 
 bool
 smap_add_once(smap_t *sh, const char *name, const void *data)
 {
     if (!smap_find(sh, name)) {
-        shash_add(sh, name, data);
+        smap_add(sh, name, data);
         return true;
     } else {
         return false;
@@ -209,6 +274,7 @@ smap_steal(smap_t *sh, struct smap_node *node)
     char *name = node->name;
 
     hmap_remove(&sh->map, &node->node);
+    sh->fingerprint -= node->node.hash;
     free(node);
     return name;
 }
@@ -219,6 +285,9 @@ smap_find__(const smap_t *sh, const char *name, size_t name_len,
 {
     struct smap_node *node;
 
+    if (sh->filter && !bloom_may_contain(sh->filter, hash)) {
+        return NULL;
+    }
     HMAP_FOR_EACH_WITH_HASH (node, node, hash, &sh->map) {
         if (!strncmp(node->name, name, name_len) && !node->name[name_len]) {
             return node;
@@ -277,14 +346,6 @@ smap_first(const smap_t *shash)
     return node ? CONTAINER_OF(node, struct smap_node, node) : NULL;
 }
 
-static int
-compare_nodes_by_name(const void *a_, const void *b_)
-{
-    const struct smap_node *const *a = a_;
-    const struct smap_node *const *b = b_;
-    return strcmp((*a)->name, (*b)->name);
-}
-
 const struct smap_node **
 smap_sort(const smap_t *sh)
 {
@@ -303,20 +364,25 @@ smap_sort(const smap_t *sh)
         }
         assert(i == n);
 
-        qsort(nodes, n, sizeof *nodes, compare_nodes_by_name);
+        string_sort_indirect((const void **) nodes, n,
+                             offsetof(struct smap_node, name));
 
         return nodes;
     }
 }
 
 /* Returns true if 'a' and 'b' contain the same keys (regardless of their
- * values), false otherwise. */
+ * values), false otherwise.
+ *
+ * Maps that differ in size or fingerprint are rejected in O(1) time.  Maps
+ * that pass both checks are compared in full. */
 bool
 smap_equal_keys(const smap_t *a, const smap_t *b)
 {
     struct smap_node *node;
 
-    if (hmap_count(&a->map) != hmap_count(&b->map)) {
+    if (hmap_count(&a->map) != hmap_count(&b->map)
+        || a->fingerprint != b->fingerprint) {
         return false;
     }
     SMAP_FOR_EACH (node, a) {
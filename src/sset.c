@@ -20,6 +20,8 @@
 
 #include "openlibc/dynamic-string.h"
 #include "openlibc/hash.h"
+#include "openlibc/string-sort.h"
+#include "openlibc/strview.h"
 #include "util.h"
 
 static uint32_t
@@ -28,39 +30,116 @@ hash_name__(const char *name, size_t length)
     return hash_bytes(name, length, 0);
 }
 
-static uint32_t
-hash_name(const char *name)
-{
-    return hash_name__(name, strlen(name));
-}
-
 static struct sset_node *
-sset_find__(const sset_t *set, const char *name, size_t hash)
+sset_find__(const sset_t *set, const char *name, size_t length, size_t hash)
 {
     struct sset_node *node;
 
+    if (set->filter && !bloom_may_contain(set->filter, hash)) {
+        return NULL;
+    }
     HMAP_FOR_EACH_WITH_HASH (node, hmap_node, hash, &set->map) {
-        if (!strcmp(node->name, name)) {
+        if (!strncmp(node->name, name, length) && !node->name[length]) {
             return node;
         }
     }
     return NULL;
 }
 
+/* Initializes 'set->filter' with room for twice the current number of
+ * strings in 'set' and adds all of those strings to it. */
+static void
+sset_init_filter__(sset_t *set)
+{
+    struct sset_node *node;
+
+    bloom_init(set->filter, 2 * sset_count(set));
+    HMAP_FOR_EACH (node, hmap_node, &set->map) {
+        bloom_add(set->filter, node->hmap_node.hash);
+    }
+}
+
+/* Replaces the filter in 'set' by one that contains only the strings now in
+ * 'set'. */
+static void
+sset_rebuild_filter__(sset_t *set)
+{
+    bloom_destroy(set->filter);
+    sset_init_filter__(set);
+}
+
+/* Inserts 'node', with the given 'hash', into 'set', updating its filter if
+ * it has one. */
+static void
+sset_insert_node__(sset_t *set, struct sset_node *node, size_t hash)
+{
+    hmap_insert(&set->map, &node->hmap_node, hash);
+    if (set->filter) {
+        if (bloom_is_full(set->filter)) {
+            sset_rebuild_filter__(set);
+        } else {
+            bloom_add(set->filter, hash);
+        }
+    }
+}
+
 static struct sset_node *
 sset_add__(sset_t *set, const char *name, size_t length, size_t hash)
 {
     struct sset_node *node = xmalloc(length + sizeof *node);
-    memcpy(node->name, name, length + 1);
-    hmap_insert(&set->map, &node->hmap_node, hash);
+    memcpy(node->name, name, length);
+    node->name[length] = '\0';
+    sset_insert_node__(set, node, hash);
     return node;
 }
 
+/* Adds a copy of 'node', which is in some other set, to 'set'.  Reuses the
+ * hash stored in 'node' instead of hashing its name again. */
+static struct sset_node *
+sset_add_copy__(sset_t *set, const struct sset_node *node)
+{
+    return sset_add__(set, node->name, strlen(node->name),
+                      node->hmap_node.hash);
+}
+
+/* Removes 'node' from 'from' and inserts it into 'to', without reallocating
+ * or rehashing it. */
+static void
+sset_move_node__(sset_t *to, sset_t *from, struct sset_node *node)
+{
+    hmap_remove(&from->map, &node->hmap_node);
+    sset_insert_node__(to, node, node->hmap_node.hash);
+}
+
+/* Exchanges the strings in 'a' and 'b', like sset_swap(), but without moving
+ * a Bloom filter from one set to the other: a set that had a filter before
+ * still has one afterward, rebuilt if necessary to match its new strings. */
+static void
+sset_swap_strings__(sset_t *a, sset_t *b)
+{
+    if (!a->filter == !b->filter) {
+        sset_swap(a, b);
+    } else {
+        hmap_swap(&a->map, &b->map);
+        sset_rebuild_filter__(a->filter ? a : b);
+    }
+}
+
+/* Returns the node in 'set' with the same name as 'node', which is in some
+ * other set, or a null pointer if 'set' does not contain that name. */
+static struct sset_node *
+sset_find_node__(const sset_t *set, const struct sset_node *node)
+{
+    return sset_find__(set, node->name, strlen(node->name),
+                       node->hmap_node.hash);
+}
+
 /* Initializes 'set' as an empty set of strings. */
 void
 sset_init(sset_t *set)
 {
     hmap_init(&set->map);
+    set->filter = NULL;
 }
 
 /* Destroys 'sets'. */
@@ -69,20 +148,22 @@ sset_destroy(sset_t *set)
 {
     if (set) {
         sset_clear(set);
+        sset_disable_filter(set);
         hmap_destroy(&set->map);
     }
 }
 
-/* Initializes 'set' to contain the same strings as 'orig'. */
+/* Initializes 'set' to contain the same strings as 'orig'.  'set' does not
+ * have a filter, even if 'orig' does. */
 void
 sset_clone(sset_t *set, const sset_t *orig)
 {
     struct sset_node *node;
 
     sset_init(set);
+    hmap_reserve(&set->map, sset_count(orig));
     HMAP_FOR_EACH (node, hmap_node, &orig->map) {
-        sset_add__(set, node->name, strlen(node->name),
-                   node->hmap_node.hash);
+        sset_add_copy__(set, node);
     }
 }
 
@@ -90,7 +171,11 @@ sset_clone(sset_t *set, const sset_t *orig)
 void
 sset_swap(sset_t *a, sset_t *b)
 {
+    struct bloom *filter = a->filter;
+
     hmap_swap(&a->map, &b->map);
+    a->filter = b->filter;
+    b->filter = filter;
 }
 
 /* Adjusts 'set' so that it is still valid after it has been moved around in
@@ -101,23 +186,49 @@ sset_moved(sset_t *set)
     hmap_moved(&set->map);
 }
 
+/* Attaches a Bloom filter to 'set', if it does not already have one, so that
+ * searches for strings that are not in 'set' usually fail after reading a
+ * single cache line, at a cost of about 4 bytes of memory per string.
+ *
+ * The filter is updated as strings are added.  Deleting strings leaves stale
+ * entries in the filter, which only make it less effective; the filter is
+ * rebuilt from scratch once enough strings have been added to it. */
+void
+sset_enable_filter(sset_t *set)
+{
+    if (!set->filter) {
+        set->filter = xmalloc(sizeof *set->filter);
+        sset_init_filter__(set);
+    }
+}
+
+/* Removes and frees the Bloom filter attached to 'set', if any. */
+void
+sset_disable_filter(sset_t *set)
+{
+    if (set->filter) {
+        bloom_destroy(set->filter);
+        free(set->filter);
+        set->filter = NULL;
+    }
+}
+
 /* Initializes 'set' with substrings of 's' that are delimited by any of the
  * characters in 'delimiters'.  For example,
  *     sset_from_delimited_string(&set, "a b,c", " ,");
  * initializes 'set' with three strings "a", "b", and "c". */
 void
-sset_from_delimited_string(sset_t *set, const char *s_,
+sset_from_delimited_string(sset_t *set, const char *s,
                            const char *delimiters)
 {
-    sset_init(set);
+    struct strview_tokenizer t;
+    strview_t token;
 
-    char *s = strdup(s_);
-    char *token, *save_ptr = NULL;
-    for (token = strtok_r(s, delimiters, &save_ptr); token != NULL;
-         token = strtok_r(NULL, delimiters, &save_ptr)) {
-        sset_add(set, token);
+    sset_init(set);
+    strview_tokenizer_init(&t, strview_from_cstr(s), delimiters);
+    while (strview_tokenizer_next(&t, &token)) {
+        sset_add_len(set, token.string, token.length);
     }
-    free(s);
 }
 
 /* Returns a malloc()'d string that consists of the concatenation of all of the
@@ -170,10 +281,18 @@ sset_count(const sset_t *set)
 struct sset_node *
 sset_add(sset_t *set, const char *name)
 {
-    size_t length = strlen(name);
+    return sset_add_len(set, name, strlen(name));
+}
+
+/* Adds the 'length' bytes in 'name', which need not be null-terminated, to
+ * 'set' as a string.  If the string is new, returns the new sset_node;
+ * otherwise (if a copy of it already existed in 'set'), returns NULL. */
+struct sset_node *
+sset_add_len(sset_t *set, const char *name, size_t length)
+{
     uint32_t hash = hash_name__(name, length);
 
-    return (sset_find__(set, name, hash)
+    return (sset_find__(set, name, length, hash)
             ? NULL
             : sset_add__(set, name, length, hash));
 }
@@ -218,6 +337,9 @@ sset_clear(sset_t *set)
     SSET_FOR_EACH_SAFE (name, next, set) {
         sset_delete(set, SSET_NODE_FROM_NAME(name));
     }
+    if (set->filter) {
+        bloom_clear(set->filter);
+    }
 }
 
 /* Deletes 'node' from 'set' and frees 'node'. */
@@ -270,7 +392,16 @@ sset_pop(sset_t *set)
 struct sset_node *
 sset_find(const sset_t *set, const char *name)
 {
-    return sset_find__(set, name, hash_name(name));
+    return sset_find_len(set, name, strlen(name));
+}
+
+/* Searches for the string that consists of the 'length' bytes in 'name',
+ * which need not be null-terminated, in 'set'.  Returns its node, if found,
+ * otherwise a null pointer. */
+struct sset_node *
+sset_find_len(const sset_t *set, const char *name, size_t length)
+{
+    return sset_find__(set, name, length, hash_name__(name, length));
 }
 
 /* Returns true if 'set' contains a copy of 'name', false otherwise. */
@@ -291,7 +422,7 @@ sset_equals(const sset_t *a, const sset_t *b)
     }
 
     HMAP_FOR_EACH (node, hmap_node, &a->map) {
-        if (!sset_find__(b, node->name, node->hmap_node.hash)) {
+        if (!sset_find_node__(b, node)) {
             return false;
         }
     }
@@ -321,15 +452,250 @@ sset_at_position(const sset_t *set, struct sset_position *pos)
 void
 sset_intersect(sset_t *a, const sset_t *b)
 {
-    const char *name, *next;
+    struct sset_node *node, *next;
 
-    SSET_FOR_EACH_SAFE (name, next, a) {
-        if (!sset_contains(b, name)) {
-            sset_delete(a, SSET_NODE_FROM_NAME(name));
+    if (sset_count(a) <= sset_count(b)) {
+        HMAP_FOR_EACH_SAFE (node, next, hmap_node, &a->map) {
+            if (!sset_find_node__(b, node)) {
+                sset_delete(a, node);
+            }
+        }
+    } else {
+        /* 'b' is smaller, so look up its strings in 'a' instead, keep the
+         * nodes that match, and throw away everything else in 'a'. */
+        sset_t tmp;
+
+        sset_init(&tmp);
+        hmap_reserve(&tmp.map, sset_count(b));
+        HMAP_FOR_EACH (node, hmap_node, &b->map) {
+            struct sset_node *match = sset_find_node__(a, node);
+            if (match) {
+                sset_move_node__(&tmp, a, match);
+            }
+        }
+        hmap_swap(&a->map, &tmp.map);
+        sset_destroy(&tmp);
+        if (a->filter) {
+            sset_rebuild_filter__(a);
         }
     }
 }
 
+/* Replaces 'a' by the union of 'a' and 'b'.  That is, adds to 'a' a copy of
+ * each string in 'b' that is not already in 'a'. */
+void
+sset_union(sset_t *a, const sset_t *b)
+{
+    struct sset_node *node;
+
+    hmap_reserve(&a->map, MAX(sset_count(a), sset_count(b)));
+    HMAP_FOR_EACH (node, hmap_node, &b->map) {
+        if (!sset_find_node__(a, node)) {
+            sset_add_copy__(a, node);
+        }
+    }
+}
+
+/* Replaces 'a' by the union of 'a' and 'b' and makes 'b' empty.  Strings are
+ * moved from the smaller set into the larger one without being copied.  If 'a'
+ * and 'b' are the same set, leaves it unchanged.  Each set keeps its Bloom
+ * filter, if it has one. */
+void
+sset_union_move(sset_t *a, sset_t *b)
+{
+    struct sset_node *node, *next;
+
+    if (a == b) {
+        return;
+    }
+    if (sset_count(a) < sset_count(b)) {
+        sset_swap_strings__(a, b);
+    }
+    HMAP_FOR_EACH_SAFE (node, next, hmap_node, &b->map) {
+        if (sset_find_node__(a, node)) {
+            sset_delete(b, node);
+        } else {
+            sset_move_node__(a, b, node);
+        }
+    }
+}
+
+/* Replaces 'a' by the difference of 'a' and 'b'.  That is, removes from 'a'
+ * all of the strings that are also in 'b'. */
+void
+sset_difference(sset_t *a, const sset_t *b)
+{
+    struct sset_node *node, *next;
+
+    if (sset_count(b) < sset_count(a)) {
+        HMAP_FOR_EACH (node, hmap_node, &b->map) {
+            struct sset_node *match = sset_find_node__(a, node);
+            if (match) {
+                sset_delete(a, match);
+            }
+        }
+    } else {
+        HMAP_FOR_EACH_SAFE (node, next, hmap_node, &a->map) {
+            if (sset_find_node__(b, node)) {
+                sset_delete(a, node);
+            }
+        }
+    }
+}
+
+/* Replaces 'a' by the symmetric difference of 'a' and 'b'.  That is, removes
+ * from 'a' the strings that are also in 'b' and adds to 'a' a copy of each of
+ * the strings in 'b' that were not in 'a'.  If 'a' and 'b' are the same set,
+ * the result is empty. */
+void
+sset_symmetric_difference(sset_t *a, const sset_t *b)
+{
+    struct sset_node *node;
+
+    if (a == b) {
+        sset_clear(a);
+        return;
+    }
+    HMAP_FOR_EACH (node, hmap_node, &b->map) {
+        struct sset_node *match = sset_find_node__(a, node);
+        if (match) {
+            sset_delete(a, match);
+        } else {
+            sset_add_copy__(a, node);
+        }
+    }
+}
+
+/* Replaces 'a' by the symmetric difference of 'a' and 'b' and makes 'b'
+ * empty.  Only the smaller of the two sets is iterated, and strings are moved
+ * between the sets without being copied.  If 'a' and 'b' are the same set,
+ * clears it.  Each set keeps its Bloom filter, if it has one. */
+void
+sset_symmetric_difference_move(sset_t *a, sset_t *b)
+{
+    struct sset_node *node, *next;
+
+    if (a == b) {
+        sset_clear(a);
+        return;
+    }
+    if (sset_count(a) < sset_count(b)) {
+        sset_swap_strings__(a, b);
+    }
+    HMAP_FOR_EACH_SAFE (node, next, hmap_node, &b->map) {
+        struct sset_node *match = sset_find_node__(a, node);
+        if (match) {
+            sset_delete(a, match);
+            sset_delete(b, node);
+        } else {
+            sset_move_node__(a, b, node);
+        }
+    }
+}
+
+/* Initializes 'set' as the intersection of 'a' and 'b', that is, as the
+ * strings that are in both 'a' and 'b'. */
+void
+sset_init_intersection(sset_t *set, const sset_t *a, const sset_t *b)
+{
+    const sset_t *small = sset_count(a) <= sset_count(b) ? a : b;
+    const sset_t *large = small == a ? b : a;
+    struct sset_node *node;
+
+    sset_init(set);
+    HMAP_FOR_EACH (node, hmap_node, &small->map) {
+        if (sset_find_node__(large, node)) {
+            sset_add_copy__(set, node);
+        }
+    }
+}
+
+/* Initializes 'set' as the union of 'a' and 'b', that is, as the strings that
+ * are in either 'a' or 'b' or both. */
+void
+sset_init_union(sset_t *set, const sset_t *a, const sset_t *b)
+{
+    const sset_t *small = sset_count(a) <= sset_count(b) ? a : b;
+    const sset_t *large = small == a ? b : a;
+    struct sset_node *node;
+
+    sset_clone(set, large);
+    HMAP_FOR_EACH (node, hmap_node, &small->map) {
+        if (!sset_find_node__(large, node)) {
+            sset_add_copy__(set, node);
+        }
+    }
+}
+
+/* Initializes 'set' as the difference of 'a' and 'b', that is, as the strings
+ * that are in 'a' but not in 'b'. */
+void
+sset_init_difference(sset_t *set, const sset_t *a, const sset_t *b)
+{
+    struct sset_node *node;
+
+    sset_init(set);
+    HMAP_FOR_EACH (node, hmap_node, &a->map) {
+        if (!sset_find_node__(b, node)) {
+            sset_add_copy__(set, node);
+        }
+    }
+}
+
+/* Initializes 'set' as the symmetric difference of 'a' and 'b', that is, as
+ * the strings that are in exactly one of 'a' and 'b'. */
+void
+sset_init_symmetric_difference(sset_t *set,
+                               const sset_t *a, const sset_t *b)
+{
+    struct sset_node *node;
+
+    sset_init(set);
+    HMAP_FOR_EACH (node, hmap_node, &a->map) {
+        if (!sset_find_node__(b, node)) {
+            sset_add_copy__(set, node);
+        }
+    }
+    HMAP_FOR_EACH (node, hmap_node, &b->map) {
+        if (!sset_find_node__(a, node)) {
+            sset_add_copy__(set, node);
+        }
+    }
+}
+
+/* Returns true if every string in 'a' is also in 'b', false otherwise. */
+bool
+sset_is_subset(const sset_t *a, const sset_t *b)
+{
+    struct sset_node *node;
+
+    if (sset_count(a) > sset_count(b)) {
+        return false;
+    }
+    HMAP_FOR_EACH (node, hmap_node, &a->map) {
+        if (!sset_find_node__(b, node)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Returns true if 'a' and 'b' have no strings in common, false otherwise. */
+bool
+sset_is_disjoint(const sset_t *a, const sset_t *b)
+{
+    const sset_t *small = sset_count(a) <= sset_count(b) ? a : b;
+    const sset_t *large = small == a ? b : a;
+    struct sset_node *node;
+
+    HMAP_FOR_EACH (node, hmap_node, &small->map) {
+        if (sset_find_node__(large, node)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 /* Returns a null-terminated array of pointers to the strings in 'set', in no
  * particular order.  The caller must free the returned array when it is no
  * longer needed, but the strings in the array belong to 'set' and thus must
@@ -353,15 +719,6 @@ sset_array(const sset_t *set)
     return array;
 }
 
-static int
-compare_string_pointers(const void *a_, const void *b_)
-{
-    const char *const *a = a_;
-    const char *const *b = b_;
-
-    return strcmp(*a, *b);
-}
-
 /* Returns a null-terminated array of pointers to the strings in 'set', sorted
  * alphabetically.  The caller must free the returned array when it is no
  * longer needed, but the strings in the array belong to 'set' and thus must
@@ -370,6 +727,6 @@ const char **
 sset_sort(const sset_t *set)
 {
     const char **array = sset_array(set);
-    qsort(array, sset_count(set), sizeof *array, compare_string_pointers);
+    string_sort(array, sset_count(set));
     return array;
 }
\ No newline at end of file
@@ -0,0 +1,383 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "openlibc/string-sort.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "openlibc/util.h"
+#include "util.h"
+
+/* An element being sorted. */
+struct sort_item {
+    uint64_t key;               /* Bytes 'depth' to 'depth + 7' of 'string'. */
+    const char *string;
+    const void *object;         /* Object that contains 'string'. */
+};
+
+/* Arrays at most this long are sorted by insertion sort. */
+#define INSERTION_SORT_MAX 16
+
+/* Arrays at least this long are sorted in parallel, by threads that each sort
+ * at least this many items. */
+#define PARALLEL_SORT_MIN (1 << 18)
+#define PARALLEL_SORT_MIN_PER_THREAD (1 << 16)
+
+/* Maximum number of threads for a parallel sort. */
+#define PARALLEL_SORT_MAX_THREADS 64
+
+/* Returns the 8 bytes of 's' starting at offset 'depth', which must not be
+ * past the end of 's', packed in big-endian order so that comparing keys as
+ * integers compares the bytes as strcmp() would.  Bytes past the end of 's'
+ * are zero.  Thus, if the least significant byte of the result is nonzero, 's'
+ * continues past 'depth + 8'. */
+static inline uint64_t
+load_key(const char *s, size_t depth)
+{
+    const unsigned char *p = (const unsigned char *) s + depth;
+    uint64_t key = 0;
+
+    for (int i = 0; i < 8 && p[i]; i++) {
+        key |= (uint64_t) p[i] << (56 - 8 * i);
+    }
+    return key;
+}
+
+static inline int
+compare_objects(const struct sort_item *a, const struct sort_item *b)
+{
+    uintptr_t x = (uintptr_t) a->object;
+    uintptr_t y = (uintptr_t) b->object;
+
+    return x < y ? -1 : x > y;
+}
+
+/* Compares 'a' and 'b', whose strings are known to be equal before offset
+ * 'depth' and whose keys were loaded at 'depth'. */
+static int
+compare_items(const struct sort_item *a, const struct sort_item *b,
+              size_t depth)
+{
+    if (a->key != b->key) {
+        return a->key < b->key ? -1 : 1;
+    } else if (a->key & 0xff) {
+        int cmp = strcmp(a->string + depth + 8, b->string + depth + 8);
+        if (cmp) {
+            return cmp;
+        }
+    }
+    return compare_objects(a, b);
+}
+
+static inline void
+swap_items(struct sort_item *a, struct sort_item *b)
+{
+    struct sort_item tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+static void
+insertion_sort(struct sort_item *items, size_t n, size_t depth)
+{
+    for (size_t i = 1; i < n; i++) {
+        struct sort_item item = items[i];
+        size_t j;
+
+        for (j = i; j > 0 && compare_items(&items[j - 1], &item, depth) > 0;
+             j--) {
+            items[j] = items[j - 1];
+        }
+        items[j] = item;
+    }
+}
+
+static int
+compare_objects_qsort(const void *a, const void *b)
+{
+    return compare_objects(a, b);
+}
+
+static uint64_t
+median3(uint64_t a, uint64_t b, uint64_t c)
+{
+    return (a < b
+            ? (b < c ? b : a < c ? c : a)
+            : (a < c ? a : b < c ? c : b));
+}
+
+/* Sorts the 'n' elements of 'items', whose strings are known to be equal
+ * before offset 'depth' and whose keys were loaded at 'depth'. */
+static void
+multikey_quicksort(struct sort_item *items, size_t n, size_t depth)
+{
+    while (n > INSERTION_SORT_MAX) {
+        uint64_t pivot = median3(items[0].key, items[n / 2].key,
+                                 items[n - 1].key);
+        size_t lt, gt, i;
+
+        /* Partition into keys less than, equal to, and greater than 'pivot',
+         * in [0, lt), [lt, gt), and [gt, n), respectively. */
+        lt = i = 0;
+        gt = n;
+        while (i < gt) {
+            if (items[i].key < pivot) {
+                swap_items(&items[lt++], &items[i++]);
+            } else if (items[i].key > pivot) {
+                swap_items(&items[i], &items[--gt]);
+            } else {
+                i++;
+            }
+        }
+
+        /* Strings with equal keys either continue, in which case they need to
+         * be sorted on their next 8 bytes, or they are identical. */
+        if (pivot & 0xff) {
+            for (i = lt; i < gt; i++) {
+                items[i].key = load_key(items[i].string, depth + 8);
+            }
+            multikey_quicksort(&items[lt], gt - lt, depth + 8);
+        } else {
+            qsort(&items[lt], gt - lt, sizeof *items, compare_objects_qsort);
+        }
+
+        /* Recurse on the smaller side and loop on the larger one, to bound
+         * the depth of the recursion. */
+        if (lt < n - gt) {
+            multikey_quicksort(items, lt, depth);
+            items += gt;
+            n -= gt;
+        } else {
+            multikey_quicksort(&items[gt], n - gt, depth);
+            n = lt;
+        }
+    }
+    insertion_sort(items, n, depth);
+}
+
+static void
+load_keys(struct sort_item *items, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        items[i].key = load_key(items[i].string, 0);
+    }
+}
+
+static void
+sort_items__(struct sort_item *items, size_t n)
+{
+    load_keys(items, n);
+    multikey_quicksort(items, n, 0);
+}
+
+/* Parallel sorting.
+ *
+ * A parallel sort divides the array into one chunk per thread, sorts the
+ * chunks concurrently, and then merges pairs of sorted runs concurrently
+ * until one run remains.  Because equal strings are ordered by address, every
+ * correct sort produces the same result, so the output is identical to that
+ * of a serial sort. */
+
+/* One unit of work for a thread: sorting 'a' (if 'b' is null) or merging 'a'
+ * and 'b' into 'dst'. */
+struct sort_task {
+    struct sort_item *a, *b, *dst;
+    size_t n_a, n_b;
+};
+
+static void *
+sort_task_run(void *task_)
+{
+    struct sort_task *task = task_;
+
+    if (!task->b) {
+        sort_items__(task->a, task->n_a);
+
+        /* Sorting leaves deeper keys in some items.  Reload the first 8
+         * bytes of each string, since the merges compare on those. */
+        load_keys(task->a, task->n_a);
+    } else {
+        const struct sort_item *a = task->a, *a_end = a + task->n_a;
+        const struct sort_item *b = task->b, *b_end = b + task->n_b;
+        struct sort_item *dst = task->dst;
+
+        while (a < a_end && b < b_end) {
+            *dst++ = compare_items(a, b, 0) <= 0 ? *a++ : *b++;
+        }
+        memcpy(dst, a, (a_end - a) * sizeof *a);
+        memcpy(dst + (a_end - a), b, (b_end - b) * sizeof *b);
+    }
+    return NULL;
+}
+
+/* Runs the 'n' tasks in 'tasks', one per thread, and waits for them to
+ * finish.  The calling thread runs the first task itself, as well as any
+ * task for which a thread cannot be created. */
+static void
+sort_tasks_run(struct sort_task *tasks, size_t n)
+{
+    pthread_t threads[PARALLEL_SORT_MAX_THREADS];
+    bool started[PARALLEL_SORT_MAX_THREADS];
+    size_t i;
+
+    for (i = 1; i < n; i++) {
+        started[i] = !pthread_create(&threads[i], NULL, sort_task_run,
+                                     &tasks[i]);
+    }
+    sort_task_run(&tasks[0]);
+    for (i = 1; i < n; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        } else {
+            sort_task_run(&tasks[i]);
+        }
+    }
+}
+
+/* Returns the number of threads to use to sort 'n' items. */
+static size_t
+sort_n_threads(size_t n)
+{
+    long int n_cpus;
+    size_t n_threads;
+
+    if (n < PARALLEL_SORT_MIN) {
+        return 1;
+    }
+
+    n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    n_threads = MIN(n / PARALLEL_SORT_MIN_PER_THREAD,
+                    PARALLEL_SORT_MAX_THREADS);
+    return n_cpus > 1 ? MIN(n_threads, (size_t) n_cpus) : 1;
+}
+
+static void
+sort_items_parallel(struct sort_item *items, size_t n, size_t n_threads)
+{
+    struct sort_task tasks[PARALLEL_SORT_MAX_THREADS];
+    size_t starts[PARALLEL_SORT_MAX_THREADS + 1];
+    struct sort_item *src, *dst;
+    size_t n_runs, i;
+
+    /* Sort each chunk. */
+    for (i = 0; i <= n_threads; i++) {
+        starts[i] = n / n_threads * i + MIN(i, n % n_threads);
+    }
+    for (i = 0; i < n_threads; i++) {
+        tasks[i] = (struct sort_task) {
+            .a = &items[starts[i]],
+            .n_a = starts[i + 1] - starts[i],
+        };
+    }
+    sort_tasks_run(tasks, n_threads);
+
+    /* Merge pairs of adjacent runs, ping-ponging between 'items' and a
+     * temporary array, until only one run is left. */
+    src = items;
+    dst = xmalloc(n * sizeof *dst);
+    for (n_runs = n_threads; n_runs > 1; n_runs = (n_runs + 1) / 2) {
+        struct sort_item *tmp;
+        size_t n_tasks = 0;
+
+        for (i = 0; i < n_runs; i += 2) {
+            size_t end = i + 2 <= n_runs ? starts[i + 2] : starts[i + 1];
+
+            tasks[n_tasks++] = (struct sort_task) {
+                .a = &src[starts[i]],
+                .n_a = starts[i + 1] - starts[i],
+                .b = &src[starts[i + 1]],
+                .n_b = end - starts[i + 1],
+                .dst = &dst[starts[i]],
+            };
+            starts[i / 2] = starts[i];
+        }
+        starts[n_tasks] = n;
+        sort_tasks_run(tasks, n_tasks);
+
+        tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    if (src != items) {
+        memcpy(items, src, n * sizeof *items);
+        free(src);
+    } else {
+        free(dst);
+    }
+}
+
+static void
+sort_items(struct sort_item *items, size_t n)
+{
+    size_t n_threads = sort_n_threads(n);
+
+    if (n_threads > 1) {
+        sort_items_parallel(items, n, n_threads);
+    } else {
+        sort_items__(items, n);
+    }
+}
+
+/* Sorts the 'n' strings in 'strings' into increasing order. */
+void
+string_sort(const char **strings, size_t n)
+{
+    struct sort_item *items;
+    size_t i;
+
+    if (n < 2) {
+        return;
+    }
+
+    items = xmalloc(n * sizeof *items);
+    for (i = 0; i < n; i++) {
+        items[i].string = items[i].object = strings[i];
+    }
+    sort_items(items, n);
+    for (i = 0; i < n; i++) {
+        strings[i] = items[i].string;
+    }
+    free(items);
+}
+
+/* Sorts the 'n' objects in 'objects' into increasing order of the
+ * null-terminated string that each one points to at offset 'name_offset',
+ * e.g. offsetof(struct smap_node, name) for an array of smap_nodes. */
+void
+string_sort_indirect(const void **objects, size_t n, size_t name_offset)
+{
+    struct sort_item *items;
+    size_t i;
+
+    if (n < 2) {
+        return;
+    }
+
+    items = xmalloc(n * sizeof *items);
+    for (i = 0; i < n; i++) {
+        items[i].object = objects[i];
+        items[i].string = *(const char *const *) ((const char *) objects[i]
+                                                  + name_offset);
+    }
+    sort_items(items, n);
+    for (i = 0; i < n; i++) {
+        objects[i] = items[i].object;
+    }
+    free(items);
+}
@@ -0,0 +1,126 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "openlibc/strview.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "openlibc/util.h"
+#include "util.h"
+
+/* Returns a null-terminated copy of 'sv', which the caller must free(). */
+char *
+strview_to_cstr(strview_t sv)
+{
+    return xmemdup0(sv.string, sv.length);
+}
+
+/* Initializes 't' to break 'input' into tokens separated by any of the
+ * characters in 'delimiters'. */
+void
+strview_tokenizer_init(struct strview_tokenizer *t, strview_t input,
+                       const char *delimiters)
+{
+    const unsigned char *d;
+
+    t->pos = input.string;
+    t->end = input.string + input.length;
+    memset(t->bitmap, 0, sizeof t->bitmap);
+    t->n_simd = 0;
+    for (d = (const unsigned char *) delimiters; *d; d++) {
+        if (!(t->bitmap[*d / 64] & (UINT64_C(1) << (*d % 64)))) {
+            t->bitmap[*d / 64] |= UINT64_C(1) << (*d % 64);
+            if (t->n_simd < ARRAY_SIZE(t->simd)) {
+                t->simd[t->n_simd] = *d;
+            }
+            t->n_simd++;
+        }
+    }
+    if (t->n_simd > ARRAY_SIZE(t->simd)) {
+        t->n_simd = 0;
+    }
+}
+
+static inline bool
+is_delimiter(const struct strview_tokenizer *t, unsigned char c)
+{
+    return (t->bitmap[c / 64] >> (c % 64)) & 1;
+}
+
+#ifdef __SSE2__
+/* Returns a bitmap with bit 'i' set if 'p[i]' is a delimiter, for 'i' in
+ * [0, 16).  't->n_simd' must be nonzero. */
+static inline unsigned int
+delimiter_mask(const struct strview_tokenizer *t, const char *p)
+{
+    __m128i block = _mm_loadu_si128((const __m128i *) p);
+    __m128i match = _mm_cmpeq_epi8(block, _mm_set1_epi8(t->simd[0]));
+
+    for (size_t i = 1; i < t->n_simd; i++) {
+        match = _mm_or_si128(match,
+                             _mm_cmpeq_epi8(block, _mm_set1_epi8(t->simd[i])));
+    }
+    return _mm_movemask_epi8(match);
+}
+#endif
+
+/* Returns the first byte at or after 'p' that is a delimiter (if 'want' is
+ * true) or not a delimiter (if 'want' is false), or 't->end' if there is
+ * none. */
+static const char *
+find_byte(const struct strview_tokenizer *t, const char *p, bool want)
+{
+#ifdef __SSE2__
+    if (t->n_simd) {
+        for (; t->end - p >= 16; p += 16) {
+            unsigned int mask = delimiter_mask(t, p);
+
+            if (!want) {
+                mask ^= 0xffff;
+            }
+            if (mask) {
+                return p + __builtin_ctz(mask);
+            }
+        }
+    }
+#endif
+    for (; p < t->end; p++) {
+        if (is_delimiter(t, *p) == want) {
+            break;
+        }
+    }
+    return p;
+}
+
+/* Stores the next token from 't' in '*token' and returns true, or returns
+ * false if there are no more tokens.  Tokens are never empty. */
+bool
+strview_tokenizer_next(struct strview_tokenizer *t, strview_t *token)
+{
+    const char *start = find_byte(t, t->pos, false);
+    const char *end;
+
+    if (start >= t->end) {
+        t->pos = t->end;
+        return false;
+    }
+
+    end = find_byte(t, start, true);
+    token->string = start;
+    token->length = end - start;
+    t->pos = end;
+    return true;
+}
@@ -21,20 +21,284 @@
 #include <assert.h>
 
 #include "openlibc/dynamic-string.h"
+#include "openlibc/hash.h"
+#include "openlibc/string-sort.h"
+#include "openlibc/strview.h"
+#include "openlibc/util.h"
 #include "util.h"
 
+/* String pool for a pooled svec.
+ *
+ * Strings are allocated sequentially from a list of blocks that is never
+ * reallocated, so that pointers into it stay valid.  Each string is preceded
+ * by its length, as a possibly unaligned size_t. */
+struct svec_pool {
+    struct svec_pool_block *blocks;   /* Most recently allocated first. */
+};
+
+struct svec_pool_block {
+    struct svec_pool_block *next;
+    size_t size;                /* Bytes in 'data'. */
+    size_t used;                /* Bytes in use in 'data'. */
+    char data[];
+};
+
+/* Size of the first block in a pool. */
+#define SVEC_POOL_MIN_BLOCK 4096
+
+static void
+svec_pool_free_blocks(struct svec_pool_block *block)
+{
+    while (block) {
+        struct svec_pool_block *next = block->next;
+        free(block);
+        block = next;
+    }
+}
+
+/* Copies the 'len' bytes in 'name' into 'pool', followed by a null
+ * terminator, and returns the copy. */
+static char *
+svec_pool_add(struct svec_pool *pool, const char *name, size_t len)
+{
+    struct svec_pool_block *block = pool->blocks;
+    size_t need = sizeof len + len + 1;
+    char *p;
+
+    if (!block || block->size - block->used < need) {
+        size_t size = block ? block->size * 2 : SVEC_POOL_MIN_BLOCK;
+
+        block = xmalloc(sizeof *block + MAX(size, need));
+        block->next = pool->blocks;
+        block->size = MAX(size, need);
+        block->used = 0;
+        pool->blocks = block;
+    }
+
+    p = &block->data[block->used];
+    block->used += need;
+    memcpy(p, &len, sizeof len);
+    p += sizeof len;
+    memcpy(p, name, len);
+    p[len] = '\0';
+    return p;
+}
+
+/* Frees the memory for every string in 'pool' at once, except that the most
+ * recently allocated (and largest) block is kept for reuse. */
+static void
+svec_pool_clear(struct svec_pool *pool)
+{
+    if (pool->blocks) {
+        svec_pool_free_blocks(pool->blocks->next);
+        pool->blocks->next = NULL;
+        pool->blocks->used = 0;
+    }
+}
+
+/* Hash index for svec_find().
+ *
+ * An open-addressing hash table, with linear probing, that maps from each
+ * string in an svec to its position.  The table is at most half full. */
+struct svec_index {
+    struct svec_index_slot *slots;
+    size_t mask;                /* Number of slots minus 1. */
+    size_t n;                   /* Number of nonempty slots. */
+};
+
+struct svec_index_slot {
+    size_t index;               /* Index in 'names' plus 1, or 0 if empty. */
+    uint32_t hash;
+};
+
+/* svec_find() builds an index for svecs with at least this many strings. */
+#define SVEC_INDEX_MIN 32
+
+static void
+svec_index_insert__(struct svec_index *index, size_t i, uint32_t hash)
+{
+    size_t slot = hash & index->mask;
+
+    while (index->slots[slot].index) {
+        slot = (slot + 1) & index->mask;
+    }
+    index->slots[slot].index = i + 1;
+    index->slots[slot].hash = hash;
+    index->n++;
+}
+
+/* Resizes 'index' to 'n_slots' slots, which must be a power of 2. */
+static void
+svec_index_resize(struct svec_index *index, size_t n_slots)
+{
+    struct svec_index_slot *old_slots = index->slots;
+    size_t old_n_slots = old_slots ? index->mask + 1 : 0;
+
+    index->slots = xcalloc(n_slots, sizeof *index->slots);
+    index->mask = n_slots - 1;
+    index->n = 0;
+    for (size_t i = 0; i < old_n_slots; i++) {
+        if (old_slots[i].index) {
+            svec_index_insert__(index, old_slots[i].index - 1,
+                                old_slots[i].hash);
+        }
+    }
+    free(old_slots);
+}
+
+/* Adds the string at position 'i' in 'svec' to its index. */
+static void
+svec_index_add(svec_t *svec, size_t i)
+{
+    struct svec_index *index = svec->index;
+
+    if (svec->names[i]) {
+        if ((index->n + 1) * 2 > index->mask + 1) {
+            svec_index_resize(index, (index->mask + 1) * 2);
+        }
+        svec_index_insert__(index, i,
+                            hash_bytes(svec->names[i], svec_len(svec, i), 0));
+    }
+}
+
+/* Builds an index for 'svec', replacing any existing one. */
+static void
+svec_index_build(svec_t *svec)
+{
+    size_t n_slots = 16;
+
+    while (n_slots < svec->n * 2) {
+        n_slots *= 2;
+    }
+
+    svec_invalidate_index(svec);
+    svec->index = xmalloc(sizeof *svec->index);
+    svec->index->slots = NULL;
+    svec_index_resize(svec->index, n_slots);
+    for (size_t i = 0; i < svec->n; i++) {
+        svec_index_add(svec, i);
+    }
+}
+
+/* Removes the entry for position 'i' from the index for 'svec'.  If
+ * 'renumber' is true, also decrements every later position, to account for
+ * removing 'i' from the middle of 'names'. */
+static void
+svec_index_remove(svec_t *svec, size_t i, bool renumber)
+{
+    struct svec_index *index = svec->index;
+    size_t slot, next;
+
+    if (svec->names[i]) {
+        uint32_t hash = hash_bytes(svec->names[i], svec_len(svec, i), 0);
+
+        for (slot = hash & index->mask; index->slots[slot].index;
+             slot = (slot + 1) & index->mask) {
+            if (index->slots[slot].index == i + 1) {
+                break;
+            }
+        }
+    } else {
+        for (slot = 0; slot <= index->mask; slot++) {
+            if (index->slots[slot].index == i + 1) {
+                break;
+            }
+        }
+    }
+    if (slot <= index->mask && index->slots[slot].index == i + 1) {
+        /* Remove the slot, then move back any later slots in the same probe
+         * sequence that could no longer be found. */
+        index->slots[slot].index = 0;
+        index->n--;
+        for (next = (slot + 1) & index->mask; index->slots[next].index;
+             next = (next + 1) & index->mask) {
+            size_t home = index->slots[next].hash & index->mask;
+            size_t home_dist = (next - home) & index->mask;
+
+            if (home_dist >= ((next - slot) & index->mask)) {
+                index->slots[slot] = index->slots[next];
+                index->slots[next].index = 0;
+                slot = next;
+            }
+        }
+    }
+
+    if (renumber) {
+        for (slot = 0; slot <= index->mask; slot++) {
+            if (index->slots[slot].index > i + 1) {
+                index->slots[slot].index--;
+            }
+        }
+    }
+}
+
+/* Frees the string at 'index' in 'svec', unless it is pooled. */
+static void
+svec_free_name__(svec_t *svec, size_t index)
+{
+    if (!svec->pool) {
+        free(svec->names[index]);
+    }
+}
+
+static void
+svec_expand(svec_t *svec)
+{
+    if (svec->n >= svec->allocated) {
+        svec->names = x2nrealloc(svec->names, &svec->allocated,
+                                 sizeof *svec->names);
+    }
+}
+
+static void
+svec_push__(svec_t *svec, char *name)
+{
+    svec_expand(svec);
+    svec->names[svec->n++] = name;
+    if (svec->index) {
+        svec_index_add(svec, svec->n - 1);
+    }
+}
+
+/* Adds a copy of the 'len' bytes in 'name', which need not be
+ * null-terminated, to 'svec' as a string. */
+void
+svec_add_len(svec_t *svec, const char *name, size_t len)
+{
+    svec_push__(svec, (svec->pool
+                       ? svec_pool_add(svec->pool, name, len)
+                       : xmemdup0(name, len)));
+}
+
 void
 svec_init(svec_t *svec)
 {
     svec->names = NULL;
     svec->n = 0;
     svec->allocated = 0;
+    svec->pool = NULL;
+    svec->index = NULL;
 }
 
+/* Initializes 'svec' as an empty pooled svec.  See the description of
+ * svec_t for details. */
 void
-svec_clone(svec_t *svec, const svec_t *other)
+svec_init_pooled(svec_t *svec)
 {
     svec_init(svec);
+    svec->pool = xmalloc(sizeof *svec->pool);
+    svec->pool->blocks = NULL;
+}
+
+/* Initializes 'svec' as a copy of 'other', pooled if 'other' is pooled. */
+void
+svec_clone(svec_t *svec, const svec_t *other)
+{
+    if (other->pool) {
+        svec_init_pooled(svec);
+    } else {
+        svec_init(svec);
+    }
     svec_append(svec, other);
 }
 
@@ -43,17 +307,29 @@ svec_destroy(svec_t *svec)
 {
     svec_clear(svec);
     free(svec->names);
+    svec_invalidate_index(svec);
+    if (svec->pool) {
+        svec_pool_free_blocks(svec->pool->blocks);
+        free(svec->pool);
+    }
 }
 
+/* Removes all of the strings from 'svec'.  For a pooled svec, this takes
+ * constant time. */
 void
 svec_clear(svec_t *svec)
 {
     size_t i;
 
-    for (i = 0; i < svec->n; i++) {
-        free(svec->names[i]);
+    if (svec->pool) {
+        svec_pool_clear(svec->pool);
+    } else {
+        for (i = 0; i < svec->n; i++) {
+            free(svec->names[i]);
+        }
     }
     svec->n = 0;
+    svec_invalidate_index(svec);
 }
 
 bool
@@ -62,10 +338,21 @@ svec_is_empty(const svec_t *svec)
     return svec->n == 0;
 }
 
+/* Ensures that 'svec' has room for at least 'n' strings in total without
+ * reallocating its array of names. */
+void
+svec_reserve(svec_t *svec, size_t n)
+{
+    if (n > svec->allocated) {
+        svec->names = xrealloc(svec->names, n * sizeof *svec->names);
+        svec->allocated = n;
+    }
+}
+
 void
 svec_add(svec_t *svec, const char *name)
 {
-    svec_add_nocopy(svec, strdup(name));
+    svec_add_len(svec, name, strlen(name));
 }
 
 void
@@ -75,27 +362,27 @@ svec_del(svec_t *svec, const char *name)
 
     offset = svec_find(svec, name);
     if (offset != SIZE_MAX) {
-        free(svec->names[offset]);
+        if (svec->index) {
+            svec_index_remove(svec, offset, true);
+        }
+        svec_free_name__(svec, offset);
         memmove(&svec->names[offset], &svec->names[offset + 1],
                 sizeof *svec->names * (svec->n - offset - 1));
         svec->n--;
     }
 }
 
-static void
-svec_expand(svec_t *svec)
-{
-    if (svec->n >= svec->allocated) {
-        svec->names = x2nrealloc(svec->names, &svec->allocated,
-                                 sizeof *svec->names);
-    }
-}
-
+/* Adds 'name' to 'svec', which takes ownership of it.  A pooled svec instead
+ * adds a copy of 'name' to its pool and frees 'name'. */
 void
 svec_add_nocopy(svec_t *svec, char *name)
 {
-    svec_expand(svec);
-    svec->names[svec->n++] = name;
+    if (svec->pool) {
+        svec_push__(svec, svec_pool_add(svec->pool, name, strlen(name)));
+        free(name);
+    } else {
+        svec_push__(svec, name);
+    }
 }
 
 void
@@ -103,31 +390,40 @@ svec_append(svec_t *svec, const svec_t *other)
 {
     size_t i;
     for (i = 0; i < other->n; i++) {
-        svec_add(svec, other->names[i]);
+        svec_add_len(svec, other->names[i], svec_len(other, i));
     }
 }
 
+/* Initializes 'svec' with the substrings of 's' that are delimited by any of
+ * the characters in 'delimiters', in order.  For example,
+ *     svec_from_delimited_string(&svec, "a b,,c", " ,");
+ * initializes 'svec' with three strings "a", "b", and "c". */
 void
-svec_terminate(svec_t *svec)
+svec_from_delimited_string(svec_t *svec, const char *s,
+                           const char *delimiters)
 {
-    svec_expand(svec);
-    svec->names[svec->n] = NULL;
+    struct strview_tokenizer t;
+    strview_t token;
+
+    svec_init(svec);
+    strview_tokenizer_init(&t, strview_from_cstr(s), delimiters);
+    while (strview_tokenizer_next(&t, &token)) {
+        svec_add_len(svec, token.string, token.length);
+    }
 }
 
-static int
-compare_strings(const void *a_, const void *b_)
+void
+svec_terminate(svec_t *svec)
 {
-    char *const *a = a_;
-    char *const *b = b_;
-    return strcmp(*a, *b);
+    svec_expand(svec);
+    svec->names[svec->n] = NULL;
 }
 
 void
 svec_sort(svec_t *svec)
 {
-    if (svec->n) {
-        qsort(svec->names, svec->n, sizeof *svec->names, compare_strings);
-    }
+    string_sort((const char **) svec->names, svec->n);
+    svec_invalidate_index(svec);
 }
 
 void
@@ -140,23 +436,45 @@ svec_sort_unique(svec_t *svec)
 void
 svec_unique(svec_t *svec)
 {
+    size_t i, j;
+
     assert(svec_is_sorted(svec));
-    if (svec->n > 1) {
-        /* This algorithm is lazy and sub-optimal, but it's "obviously correct"
-         * and asymptotically optimal . */
-        svec_t tmp;
-        size_t i;
+    for (i = j = 1; i < svec->n; i++) {
+        if (strcmp(svec->names[j - 1], svec->names[i])) {
+            svec->names[j++] = svec->names[i];
+        } else {
+            svec_free_name__(svec, i);
+        }
+    }
+    if (svec->n) {
+        svec->n = j;
+    }
+    svec_invalidate_index(svec);
+}
 
-        svec_init(&tmp);
-        svec_add(&tmp, svec->names[0]);
-        for (i = 1; i < svec->n; i++) {
-            if (strcmp(svec->names[i - 1], svec->names[i])) {
-                svec_add(&tmp, svec->names[i]);
-            }
+/* Removes from 'svec' each string for which 'pred', called with the string
+ * and 'aux', returns true, keeping the remaining strings in order, and
+ * returns the number removed.  Takes a single pass over 'svec', so it is
+ * much faster than calling svec_del() for each string to remove. */
+size_t
+svec_remove_if(svec_t *svec, bool (*pred)(const char *name, void *aux),
+               void *aux)
+{
+    size_t i, j;
+
+    for (i = j = 0; i < svec->n; i++) {
+        if (pred(svec->names[i], aux)) {
+            svec_free_name__(svec, i);
+        } else {
+            svec->names[j++] = svec->names[i];
         }
-        svec_swap(&tmp, svec);
-        svec_destroy(&tmp);
     }
+    svec->n = j;
+
+    if (i != j && svec->index) {
+        svec_index_build(svec);
+    }
+    return i - j;
 }
 
 void
@@ -170,6 +488,9 @@ svec_compact(svec_t *svec)
         }
     }
     svec->n = j;
+    if (svec->index) {
+        svec_index_build(svec);
+    }
 }
 
 static void
@@ -193,55 +514,260 @@ svec_shuffle(svec_t *svec)
         size_t j = i + random_range(svec->n - i);
         swap_strings(&svec->names[i], &svec->names[j]);
     }
+    svec_invalidate_index(svec);
 }
 
-void
-svec_diff(const svec_t *a, const svec_t *b,
-          svec_t *a_only, svec_t *both, svec_t *b_only)
+/* Initializes whichever of 'a_only', 'both', and 'b_only' are nonnull as
+ * empty svecs with room for the largest possible results of diffing 'a' and
+ * 'b'. */
+static void
+svec_diff_init__(const svec_t *a, const svec_t *b,
+                 svec_t *a_only, svec_t *both, svec_t *b_only)
 {
-    size_t i, j;
-
-    assert(svec_is_sorted(a));
-    assert(svec_is_sorted(b));
     if (a_only) {
         svec_init(a_only);
+        svec_reserve(a_only, a->n);
     }
     if (both) {
         svec_init(both);
+        svec_reserve(both, MIN(a->n, b->n));
     }
     if (b_only) {
         svec_init(b_only);
+        svec_reserve(b_only, b->n);
+    }
+}
+
+/* Adds the strings in 'svec' from 'start' up to but not including 'end' to
+ * 'dst', if 'dst' is nonnull. */
+static void
+svec_add_range__(svec_t *dst, const svec_t *svec, size_t start, size_t end)
+{
+    if (dst) {
+        for (size_t i = start; i < end; i++) {
+            svec_add_len(dst, svec->names[i], svec_len(svec, i));
+        }
     }
+}
+
+/* Returns the index of the first string in sorted 'svec', starting at
+ * 'start', that is not less than 'name', or 'svec->n' if there is none.
+ * Takes O(log d) time, where 'd' is the distance from 'start' to the
+ * result. */
+static size_t
+svec_gallop(const svec_t *svec, size_t start, const char *name)
+{
+    size_t lo = start, step = 1;
+
+    /* Find a range (lo, hi] that contains the answer, by doubling steps. */
+    while (lo < svec->n && strcmp(svec->names[lo], name) < 0) {
+        size_t hi = lo + step < svec->n ? lo + step : svec->n;
+
+        if (hi == svec->n || strcmp(svec->names[hi], name) >= 0) {
+            /* Binary search in (lo, hi]. */
+            while (hi - lo > 1) {
+                size_t mid = lo + (hi - lo) / 2;
+                if (strcmp(svec->names[mid], name) < 0) {
+                    lo = mid;
+                } else {
+                    hi = mid;
+                }
+            }
+            return hi;
+        }
+        lo = hi;
+        step *= 2;
+    }
+    return lo;
+}
+
+/* Diffs sorted 'small' against sorted 'large', which should be much larger,
+ * by searching 'large' for each string in 'small' rather than by stepping
+ * through every string in 'large'.  Strings that it skips over in 'large' are
+ * only visited if 'large_only' is nonnull. */
+static void
+svec_diff_gallop(const svec_t *small, const svec_t *large,
+                 svec_t *small_only, svec_t *both, svec_t *large_only)
+{
+    size_t i, j;
+
+    for (i = j = 0; i < small->n && j < large->n; i++) {
+        const char *name = small->names[i];
+        size_t k = svec_gallop(large, j, name);
+
+        svec_add_range__(large_only, large, j, k);
+        j = k;
+        if (j < large->n && !strcmp(large->names[j], name)) {
+            svec_add_range__(both, small, i, i + 1);
+            j++;
+        } else {
+            svec_add_range__(small_only, small, i, i + 1);
+        }
+    }
+    svec_add_range__(small_only, small, i, small->n);
+    svec_add_range__(large_only, large, j, large->n);
+}
+
+/* When one input to svec_diff() is at least this many times larger than the
+ * other, searching the larger input is faster than merging. */
+#define SVEC_DIFF_GALLOP_RATIO 16
+
+/* Initializes whichever of 'a_only', 'both', and 'b_only' are nonnull as
+ * copies of the strings in only 'a', in both 'a' and 'b', and in only 'b',
+ * respectively, all in sorted order.  'a' and 'b' must be sorted.  A string
+ * that appears more than once in 'a' or 'b' is paired off against its
+ * duplicates one at a time, so that, for example, diffing ["x", "x"]
+ * against ["x"] yields "x" in both 'a_only' and 'both'. */
+void
+svec_diff(const svec_t *a, const svec_t *b,
+          svec_t *a_only, svec_t *both, svec_t *b_only)
+{
+    size_t i, j;
+
+    assert(svec_is_sorted(a));
+    assert(svec_is_sorted(b));
+    svec_diff_init__(a, b, a_only, both, b_only);
+    if (a->n / SVEC_DIFF_GALLOP_RATIO > b->n) {
+        svec_diff_gallop(b, a, b_only, both, a_only);
+        return;
+    } else if (b->n / SVEC_DIFF_GALLOP_RATIO > a->n) {
+        svec_diff_gallop(a, b, a_only, both, b_only);
+        return;
+    }
+
     for (i = j = 0; i < a->n && j < b->n; ) {
         int cmp = strcmp(a->names[i], b->names[j]);
         if (cmp < 0) {
-            if (a_only) {
-                svec_add(a_only, a->names[i]);
-            }
+            svec_add_range__(a_only, a, i, i + 1);
             i++;
         } else if (cmp > 0) {
-            if (b_only) {
-                svec_add(b_only, b->names[j]);
-            }
+            svec_add_range__(b_only, b, j, j + 1);
             j++;
         } else {
-            if (both) {
-                svec_add(both, a->names[i]);
-            }
+            svec_add_range__(both, a, i, i + 1);
             i++;
             j++;
         }
     }
-    if (a_only) {
-        for (; i < a->n; i++) {
-            svec_add(a_only, a->names[i]);
+    svec_add_range__(a_only, a, i, a->n);
+    svec_add_range__(b_only, b, j, b->n);
+}
+
+/* A hash table over the strings in an svec, for svec_diff_unsorted().  Each
+ * string may be claimed once by a matching string from another svec. */
+struct svec_diff_table {
+    const svec_t *svec;
+    size_t *slots;              /* Index in 'svec' plus 1, or 0 if empty. */
+    uint32_t *hashes;           /* Hash of each string in 'svec'. */
+    bool *claimed;              /* Whether each string in 'svec' matched. */
+    size_t mask;
+};
+
+static void
+svec_diff_table_init(struct svec_diff_table *t, const svec_t *svec)
+{
+    size_t n_slots = 16;
+
+    while (n_slots < svec->n * 2) {
+        n_slots *= 2;
+    }
+    t->svec = svec;
+    t->slots = xcalloc(n_slots, sizeof *t->slots);
+    t->hashes = xmalloc(svec->n * sizeof *t->hashes);
+    t->claimed = xcalloc(svec->n, sizeof *t->claimed);
+    t->mask = n_slots - 1;
+
+    for (size_t i = 0; i < svec->n; i++) {
+        uint32_t hash = hash_bytes(svec->names[i], svec_len(svec, i), 0);
+        size_t slot = hash & t->mask;
+
+        while (t->slots[slot]) {
+            slot = (slot + 1) & t->mask;
         }
+        t->slots[slot] = i + 1;
+        t->hashes[i] = hash;
     }
-    if (b_only) {
-        for (; j < b->n; j++) {
-            svec_add(b_only, b->names[j]);
+}
+
+static void
+svec_diff_table_destroy(struct svec_diff_table *t)
+{
+    free(t->slots);
+    free(t->hashes);
+    free(t->claimed);
+}
+
+/* Finds a string in 't' equal to the 'len' bytes in 'name' that has not
+ * already been claimed, claims it, and returns true.  Returns false if there
+ * is no such string. */
+static bool
+svec_diff_table_claim(struct svec_diff_table *t, const char *name, size_t len)
+{
+    uint32_t hash = hash_bytes(name, len, 0);
+
+    for (size_t slot = hash & t->mask; t->slots[slot];
+         slot = (slot + 1) & t->mask) {
+        size_t i = t->slots[slot] - 1;
+
+        if (t->hashes[i] == hash && !t->claimed[i]
+            && svec_len(t->svec, i) == len
+            && !memcmp(t->svec->names[i], name, len)) {
+            t->claimed[i] = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Adds the strings in 't' that were claimed (if 'claimed' is true) or not
+ * claimed (if 'claimed' is false) to 'dst', if 'dst' is nonnull. */
+static void
+svec_diff_table_collect(const struct svec_diff_table *t, bool claimed,
+                        svec_t *dst)
+{
+    if (dst) {
+        for (size_t i = 0; i < t->svec->n; i++) {
+            if (t->claimed[i] == claimed) {
+                svec_add_range__(dst, t->svec, i, i + 1);
+            }
+        }
+    }
+}
+
+/* Like svec_diff(), but 'a' and 'b' need not be sorted, and the results are
+ * not sorted either: strings in 'a_only' and 'both' are in the order they
+ * appear in 'a', and strings in 'b_only' in the order they appear in 'b'.
+ *
+ * This takes time linear in the total size of 'a' and 'b', using a temporary
+ * hash table over the smaller of the two. */
+void
+svec_diff_unsorted(const svec_t *a, const svec_t *b,
+                   svec_t *a_only, svec_t *both, svec_t *b_only)
+{
+    struct svec_diff_table t;
+
+    svec_diff_init__(a, b, a_only, both, b_only);
+    if (a->n <= b->n) {
+        svec_diff_table_init(&t, a);
+        for (size_t j = 0; j < b->n; j++) {
+            if (!svec_diff_table_claim(&t, b->names[j], svec_len(b, j))) {
+                svec_add_range__(b_only, b, j, j + 1);
+            }
         }
+        svec_diff_table_collect(&t, false, a_only);
+        svec_diff_table_collect(&t, true, both);
+    } else {
+        svec_diff_table_init(&t, b);
+        for (size_t i = 0; i < a->n; i++) {
+            if (svec_diff_table_claim(&t, a->names[i], svec_len(a, i))) {
+                svec_add_range__(both, a, i, i + 1);
+            } else {
+                svec_add_range__(a_only, a, i, i + 1);
+            }
+        }
+        svec_diff_table_collect(&t, false, b_only);
     }
+    svec_diff_table_destroy(&t);
 }
 
 bool
@@ -250,15 +776,69 @@ svec_contains(const svec_t *svec, const char *name)
     return svec_find(svec, name) != SIZE_MAX;
 }
 
+/* Returns the position of the first string in 'svec' equal to 'name', or
+ * SIZE_MAX if there is none.  'svec' need not be sorted.
+ *
+ * Small svecs are searched linearly.  The first search of a larger svec
+ * builds an index that makes this and later searches take O(1) time on
+ * average. */
 size_t
 svec_find(const svec_t *svec, const char *name)
 {
-    char **p;
+    return svec_find_len(svec, name, strlen(name));
+}
 
-    assert(svec_is_sorted(svec));
-    p = bsearch(&name, svec->names, svec->n, sizeof *svec->names,
-                compare_strings);
-    return p ? p - svec->names : SIZE_MAX;
+/* Like svec_find(), but searches for the string that consists of the 'len'
+ * bytes in 'name', which need not be null-terminated. */
+size_t
+svec_find_len(const svec_t *svec_, const char *name, size_t len)
+{
+    svec_t *svec = CONST_CAST(svec_t *, svec_);
+    const struct svec_index *index;
+    size_t found;
+    uint32_t hash;
+
+    if (!svec->index) {
+        if (svec->n < SVEC_INDEX_MIN) {
+            for (size_t i = 0; i < svec->n; i++) {
+                const char *s = svec->names[i];
+
+                if (s && !strncmp(s, name, len) && !s[len]) {
+                    return i;
+                }
+            }
+            return SIZE_MAX;
+        }
+        svec_index_build(svec);
+    }
+
+    index = svec->index;
+    hash = hash_bytes(name, len, 0);
+    found = SIZE_MAX;
+    for (size_t slot = hash & index->mask; index->slots[slot].index;
+         slot = (slot + 1) & index->mask) {
+        size_t i = index->slots[slot].index - 1;
+        const char *s = svec->names[i];
+
+        if (index->slots[slot].hash == hash && i < found
+            && s && !strncmp(s, name, len) && !s[len]) {
+            found = i;
+        }
+    }
+    return found;
+}
+
+/* Discards the index that svec_find() may have built for 'svec'.  Code that
+ * reorders or replaces strings in 'svec->names' directly must call this
+ * afterward. */
+void
+svec_invalidate_index(svec_t *svec)
+{
+    if (svec->index) {
+        free(svec->index->slots);
+        free(svec->index);
+        svec->index = NULL;
+    }
 }
 
 bool
@@ -389,7 +969,7 @@ svec_join(const svec_t *svec,
         if (i) {
             ds_put_cstr(&ds, delimiter);
         }
-        ds_put_cstr(&ds, svec->names[i]);
+        ds_put_buffer(&ds, svec->names[i], svec_len(svec, i));
     }
     ds_put_cstr(&ds, terminator);
     return ds_cstr(&ds);
@@ -406,5 +986,22 @@ void
 svec_pop_back(svec_t *svec)
 {
     assert(svec->n);
-    free(svec->names[--svec->n]);
+    if (svec->index) {
+        svec_index_remove(svec, svec->n - 1, false);
+    }
+    svec_free_name__(svec, --svec->n);
+}
+
+/* Returns the length of the string at 'index' in 'svec'.  This takes constant
+ * time for a pooled svec. */
+size_t
+svec_len(const svec_t *svec, size_t index)
+{
+    size_t len;
+
+    if (!svec->pool) {
+        return strlen(svec->names[index]);
+    }
+    memcpy(&len, svec->names[index] - sizeof len, sizeof len);
+    return len;
 }
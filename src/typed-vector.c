@@ -0,0 +1,107 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "openlibc/typed-vector.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "util.h"
+
+/* Returns 'data', reallocated if necessary to hold at least 'n' elements of
+ * 'elem_size' bytes each, and updates '*allocated' to the new capacity.
+ * Grows by at least half again each time, so that a sequence of appends
+ * takes amortized constant time per element. */
+void *
+tvec_reserve__(void *data, size_t *allocated, size_t n, size_t elem_size)
+{
+    size_t new_allocated;
+
+    if (n <= *allocated) {
+        return data;
+    }
+
+    new_allocated = *allocated + *allocated / 2;
+    if (new_allocated < n) {
+        new_allocated = n;
+    }
+    if (new_allocated < 4) {
+        new_allocated = 4;
+    }
+    if (new_allocated > SIZE_MAX / elem_size) {
+        out_of_memory();
+    }
+
+    *allocated = new_allocated;
+    return xrealloc(data, new_allocated * elem_size);
+}
+
+/* Returns 'data', reallocated to hold exactly 'n' elements of 'elem_size'
+ * bytes each, or freed and replaced by null if 'n' is 0, and updates
+ * '*allocated' to match. */
+void *
+tvec_shrink__(void *data, size_t *allocated, size_t n, size_t elem_size)
+{
+    if (n == *allocated) {
+        return data;
+    }
+
+    *allocated = n;
+    if (!n) {
+        free(data);
+        return NULL;
+    }
+    return xrealloc(data, n * elem_size);
+}
+
+/* Moves the element at position '*n' in 'data', just past the '*n' elements
+ * of 'elem_size' bytes each in use, to position 'idx', moving the elements
+ * from 'idx' on up by one, and increments '*n'. */
+void
+tvec_insert__(void *data, size_t *n, size_t idx, size_t elem_size)
+{
+    char *p = data;
+
+    assert(idx <= *n);
+    if (idx < *n) {
+        char stub[64];
+        char *tmp = elem_size <= sizeof stub ? stub : xmalloc(elem_size);
+
+        memcpy(tmp, p + *n * elem_size, elem_size);
+        memmove(p + (idx + 1) * elem_size, p + idx * elem_size,
+                (*n - idx) * elem_size);
+        memcpy(p + idx * elem_size, tmp, elem_size);
+        if (tmp != stub) {
+            free(tmp);
+        }
+    }
+    ++*n;
+}
+
+/* Removes the 'count' elements starting at position 'idx' from the '*n'
+ * elements of 'elem_size' bytes each in 'data', moving later elements down,
+ * and decrements '*n' by 'count'. */
+void
+tvec_erase__(void *data, size_t *n, size_t idx, size_t count,
+             size_t elem_size)
+{
+    char *p = data;
+
+    assert(idx <= *n && count <= *n - idx);
+    if (idx + count < *n) {
+        memmove(p + idx * elem_size, p + (idx + count) * elem_size,
+                (*n - idx - count) * elem_size);
+    }
+    *n -= count;
+}
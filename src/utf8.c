@@ -0,0 +1,297 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "openlibc/utf8.h"
+
+#include <stdint.h>
+
+#include "simd.h"
+#include "util.h"
+
+#if HAVE_X86_SIMD
+#include <tmmintrin.h>
+#endif
+
+/* Examines the 'n' bytes at 's', where 'n' > 0.  If they begin with a
+ * well-formed UTF-8 sequence, returns its length.  Otherwise, returns the
+ * negated length of the maximal subpart of an ill-formed sequence at 's',
+ * that is, the longest prefix of 's' that is also a prefix of some
+ * well-formed sequence, or 1 if there is no such prefix (see "U+FFFD
+ * Substitution of Maximal Subparts" in chapter 3 of the Unicode Standard). */
+static int
+utf8_scan_char(const uint8_t *s, size_t n)
+{
+    uint8_t c = s[0];
+    uint8_t lo = 0x80, hi = 0xbf;   /* Range of the second byte. */
+    int len;
+    int i;
+
+    if (c < 0x80) {
+        return 1;
+    } else if (c < 0xc2) {
+        return -1;
+    } else if (c < 0xe0) {
+        len = 2;
+    } else if (c < 0xf0) {
+        len = 3;
+        if (c == 0xe0) {
+            lo = 0xa0;          /* Overlong. */
+        } else if (c == 0xed) {
+            hi = 0x9f;          /* Surrogate. */
+        }
+    } else if (c < 0xf5) {
+        len = 4;
+        if (c == 0xf0) {
+            lo = 0x90;          /* Overlong. */
+        } else if (c == 0xf4) {
+            hi = 0x8f;          /* Above U+10FFFF. */
+        }
+    } else {
+        return -1;
+    }
+
+    for (i = 1; i < len; i++) {
+        if ((size_t) i >= n || s[i] < lo || s[i] > hi) {
+            return -i;
+        }
+        lo = 0x80;
+        hi = 0xbf;
+    }
+    return len;
+}
+
+/* Returns the length of the longest prefix of the 'n' bytes at 's' that is
+ * valid UTF-8, working one character at a time. */
+static size_t
+utf8_valid_prefix_scalar(const uint8_t *s, size_t n)
+{
+    size_t i = 0;
+
+    while (i < n) {
+        int len;
+
+        if (s[i] < 0x80) {
+            i++;
+            continue;
+        }
+        len = utf8_scan_char(&s[i], n - i);
+        if (len < 0) {
+            break;
+        }
+        i += len;
+    }
+    return i;
+}
+
+#if HAVE_X86_SIMD
+/* Error classes for the lookup-table validator by John Keiser and Daniel
+ * Lemire, from "Validating UTF-8 In Less Than One Instruction Per Byte".
+ * Each table maps 4 bits of a pair of adjacent bytes to the set of errors
+ * that those bits allow, so that a pair is erroneous if the three sets have
+ * an error in common. */
+#define TOO_SHORT (1 << 0)      /* Lead byte or ASCII, then lead byte. */
+#define TOO_LONG (1 << 1)       /* ASCII, then continuation byte. */
+#define OVERLONG_3 (1 << 2)
+#define TOO_LARGE (1 << 3)
+#define SURROGATE (1 << 4)
+#define OVERLONG_2 (1 << 5)
+#define TOO_LARGE_1000 (1 << 6)
+#define OVERLONG_4 (1 << 6)
+#define TWO_CONTS (1 << 7)      /* Two continuation bytes. */
+#define CARRY (TOO_SHORT | TOO_LONG | TWO_CONTS)
+
+/* Returns nonzero bytes where the 16 bytes in 'input', preceded by the 16
+ * bytes in 'prev', contain an error, except that a sequence truncated at the
+ * end of 'input' is not an error. */
+static inline __m128i TARGET_SSSE3
+utf8_check_block(__m128i input, __m128i prev)
+{
+    const __m128i byte_1_high_table = _mm_setr_epi8(
+        /* 0xxx: ASCII. */
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        /* 10xx: continuation. */
+        TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+        /* 1100, 1101: 2-byte lead. */
+        TOO_SHORT | OVERLONG_2,
+        TOO_SHORT,
+        /* 1110: 3-byte lead. */
+        TOO_SHORT | OVERLONG_3 | SURROGATE,
+        /* 1111: 4-byte lead. */
+        TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4);
+    const __m128i byte_1_low_table = _mm_setr_epi8(
+        CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+        CARRY | OVERLONG_2,
+        CARRY,
+        CARRY,
+        CARRY | TOO_LARGE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000);
+    const __m128i byte_2_high_table = _mm_setr_epi8(
+        /* 0xxx: ASCII. */
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        /* 1000, 1001, 101x: continuation. */
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000
+        | OVERLONG_4,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        /* 11xx: lead. */
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT);
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+
+    __m128i prev1 = _mm_alignr_epi8(input, prev, 15);
+    __m128i prev2 = _mm_alignr_epi8(input, prev, 14);
+    __m128i prev3 = _mm_alignr_epi8(input, prev, 13);
+
+    /* Errors visible in each pair of adjacent bytes. */
+    __m128i byte_1_high = _mm_shuffle_epi8(
+        byte_1_high_table, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble));
+    __m128i byte_1_low = _mm_shuffle_epi8(byte_1_low_table,
+                                          _mm_and_si128(prev1, nibble));
+    __m128i byte_2_high = _mm_shuffle_epi8(
+        byte_2_high_table, _mm_and_si128(_mm_srli_epi16(input, 4), nibble));
+    __m128i special = _mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low),
+                                    byte_2_high);
+
+    /* The third and fourth bytes of 3- and 4-byte sequences must be
+     * continuation bytes.  The tables flag them as TWO_CONTS, which is
+     * correct exactly when the byte 2 or 3 earlier is such a lead byte. */
+    __m128i is_third = _mm_subs_epu8(prev2, _mm_set1_epi8(0xe0 - 0x80));
+    __m128i is_fourth = _mm_subs_epu8(prev3, _mm_set1_epi8(0xf0 - 0x80));
+    __m128i must_be_cont = _mm_and_si128(_mm_or_si128(is_third, is_fourth),
+                                         _mm_set1_epi8(0x80));
+
+    return _mm_xor_si128(must_be_cont, special);
+}
+
+static inline bool
+utf8_is_zero(__m128i x)
+{
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_setzero_si128())) == 0xffff;
+}
+
+/* Returns true if the 16 bytes in 'x' end with a lead byte whose sequence
+ * would continue past them. */
+static inline bool TARGET_SSSE3
+utf8_is_incomplete(__m128i x)
+{
+    const __m128i max = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1,
+                                      -1, -1, -1, -1, -1,
+                                      0xf0 - 1, 0xe0 - 1, 0xc0 - 1);
+
+    return !utf8_is_zero(_mm_subs_epu8(x, max));
+}
+
+/* Validates the 'n' bytes at 's' 16 at a time, stopping at the first block
+ * that contains an error or when fewer than 16 bytes remain.  Returns a
+ * position in 's' that begins a character and before which 's' is known to
+ * be valid. */
+static size_t TARGET_SSSE3
+utf8_valid_prefix_ssse3(const uint8_t *s, size_t n)
+{
+    __m128i prev = _mm_setzero_si128();
+    size_t i, k;
+
+    for (i = 0; i + 16 <= n; i += 16) {
+        __m128i input = _mm_loadu_si128((const __m128i *) &s[i]);
+
+        if (!_mm_movemask_epi8(input)) {
+            /* All ASCII: valid unless the previous block ended in the middle
+             * of a character, which the scalar code will then find. */
+            if (utf8_is_incomplete(prev)) {
+                break;
+            }
+        } else if (!utf8_is_zero(utf8_check_block(input, prev))) {
+            break;
+        }
+        prev = input;
+    }
+
+    /* Back up to the start of any character that began before 'i' but did
+     * not end before it. */
+    for (k = 1; k <= 3 && k <= i; k++) {
+        uint8_t c = s[i - k];
+
+        if ((c & 0xc0) != 0x80) {
+            size_t len = c < 0xe0 ? (c < 0x80 ? 1 : 2) : (c < 0xf0 ? 3 : 4);
+            if (len > k) {
+                i -= k;
+            }
+            break;
+        }
+    }
+    return i;
+}
+#endif
+
+/* Returns the length of the longest prefix of the 'n' bytes at 's' that is
+ * valid UTF-8.  The prefix never ends in the middle of a character. */
+size_t
+utf8_valid_prefix(const char *s_, size_t n)
+{
+    const uint8_t *s = (const uint8_t *) s_;
+    size_t i = 0;
+
+#if HAVE_X86_SIMD
+    if (n >= 16 && cpu_has_ssse3()) {
+        i = utf8_valid_prefix_ssse3(s, n);
+    }
+#endif
+    return i + utf8_valid_prefix_scalar(&s[i], n - i);
+}
+
+/* Returns true if the 'n' bytes at 's' are entirely valid UTF-8. */
+bool
+utf8_is_valid(const char *s, size_t n)
+{
+    return utf8_valid_prefix(s, n) == n;
+}
+
+/* Appends the 'n' bytes at 's' to 'ds', replacing each ill-formed sequence
+ * by the replacement character U+FFFD.  Following the Unicode Standard's
+ * recommended practice, each maximal subpart of an ill-formed sequence
+ * becomes one U+FFFD, e.g. "\xe2\x82" (a truncated 3-byte sequence) becomes
+ * one U+FFFD and "\xc0\xaf" (an overlong sequence) becomes two.  Valid runs
+ * are found with utf8_valid_prefix() and copied in bulk. */
+void
+ds_put_utf8_sanitized(ds_t *ds, const char *s, size_t n)
+{
+    while (n > 0) {
+        size_t valid = utf8_valid_prefix(s, n);
+        int len;
+
+        ds_put_buffer(ds, s, valid);
+        s += valid;
+        n -= valid;
+        if (!n) {
+            break;
+        }
+
+        len = -utf8_scan_char((const uint8_t *) s, n);
+        ds_put_buffer(ds, "\xef\xbf\xbd", 3);
+        s += len;
+        n -= len;
+    }
+}
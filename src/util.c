@@ -36,6 +36,22 @@ xmalloc(size_t size)
     return p;
 }
 
+void *
+xcalloc(size_t count, size_t size)
+{
+    void *p = count && size ? calloc(count, size) : malloc(1);
+    if (p == NULL) {
+        out_of_memory();
+    }
+    return p;
+}
+
+void *
+xzalloc(size_t size)
+{
+    return xcalloc(1, size);
+}
+
 void *
 xrealloc(void *p, size_t size)
 {
@@ -68,4 +84,35 @@ x2nrealloc(void *p, size_t *n, size_t s)
 {
     *n = *n == 0 ? 1 : 2 * *n;
     return xrealloc(p, *n * s);
-}
\ No newline at end of file
+}
+
+/* Allocates and returns 'size' bytes of memory aligned to a cache line
+ * boundary.  The memory must be freed with free_cacheline(). */
+void *
+xmalloc_cacheline(size_t size)
+{
+    void *p;
+
+    if (posix_memalign(&p, CACHE_LINE_SIZE, size ? size : 1)) {
+        out_of_memory();
+    }
+    return p;
+}
+
+/* Like xmalloc_cacheline() but clears the allocated memory to all zero
+ * bytes. */
+void *
+xzalloc_cacheline(size_t size)
+{
+    void *p = xmalloc_cacheline(size);
+    memset(p, 0, size);
+    return p;
+}
+
+/* Frees 'p', which must have been allocated with xmalloc_cacheline() or
+ * xzalloc_cacheline(). */
+void
+free_cacheline(void *p)
+{
+    free(p);
+}
@@ -1,10 +1,13 @@
 #include "openlibc/vector.h"
 
 #include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
 
+#include "util.h"
+
 const vector_t EMPTY_VECTOR = {NULL, 0, 0};
 
 void vector_init(vector_t *vector, size_t capacity)
@@ -12,7 +15,7 @@ void vector_init(vector_t *vector, size_t capacity)
     vector->length = 0;
     vector->capacity = capacity;
     if (capacity > 0) {
-        vector->data = malloc(sizeof(void*) * capacity);
+        vector->data = xmalloc(sizeof(void*) * capacity);
     } else {
         vector->data = NULL;
     }
@@ -20,33 +23,61 @@ void vector_init(vector_t *vector, size_t capacity)
 
 void vector_destroy(vector_t *vector)
 {
-    if (vector->capacity > 0) {
-        free(vector->data);
+    free(vector->data);
+    vector->data = NULL;
+    vector->length = vector->capacity = 0;
+}
+
+/* Reallocates 'vector''s array to hold exactly 'capacity' elements. */
+static void set_capacity(vector_t *vector, size_t capacity)
+{
+    if (capacity > SIZE_MAX / sizeof(void *)) {
+        out_of_memory();
     }
+    vector->data = xrealloc(vector->data, sizeof(void *) * capacity);
+    vector->capacity = capacity;
 }
 
-static void enlarge_vector_if_full(vector_t *vector)
+/* Ensures that 'vector' has room for at least 'capacity' elements without
+ * further reallocation. */
+void vector_reserve(vector_t *vector, size_t capacity)
 {
-    if (vector->length >= vector->capacity) {
-        if (vector->capacity) {
-            size_t old_bytes = sizeof(void *) * vector->capacity;
-            vector->capacity *= 2;
-            size_t bytes = sizeof(void *) * vector->capacity;
-            void **temp = malloc(bytes);
-            memcpy(temp, vector->data, old_bytes);
-            free(vector->data);
-            vector->data = temp;
-        } else {
-            // null vector, need not free data
-            vector->capacity = 2;
-            vector->data = malloc(sizeof(void *) * vector->capacity);
-        }
+    if (capacity > vector->capacity) {
+        set_capacity(vector, capacity);
+    }
+}
+
+/* Reduces the memory allocated by 'vector' to what its elements need. */
+void vector_shrink_to_fit(vector_t *vector)
+{
+    if (vector->length == vector->capacity) {
+        return;
+    } else if (vector->length) {
+        set_capacity(vector, vector->length);
+    } else {
+        vector_destroy(vector);
+    }
+}
+
+/* Makes room for at least 'n' more elements in 'vector', at least doubling
+ * its capacity if it must grow, so that repeated appends take amortized
+ * constant time. */
+static void enlarge_vector(vector_t *vector, size_t n)
+{
+    size_t needed = vector->length + n;
+
+    if (needed < vector->length) {
+        out_of_memory();
+    }
+    if (needed > vector->capacity) {
+        size_t capacity = vector->capacity ? vector->capacity * 2 : 2;
+        set_capacity(vector, capacity > needed ? capacity : needed);
     }
 }
 
 void vector_add(vector_t *vector, void *element)
 {
-    enlarge_vector_if_full(vector);
+    enlarge_vector(vector, 1);
     assert(vector->data);
     assert(vector->length < vector->capacity);
     vector->data[vector->length++] = element;
@@ -61,6 +92,16 @@ void *vector_pop(vector_t *vector)
     return vector->data[--vector->length];
 }
 
+/* Appends the 'n' pointers in 'elements' to 'vector'. */
+void vector_add_array(vector_t *vector, void *const *elements, size_t n)
+{
+    if (n) {
+        enlarge_vector(vector, n);
+        memcpy(&vector->data[vector->length], elements, sizeof(void *) * n);
+        vector->length += n;
+    }
+}
+
 int vector_index_of(vector_t *vector, const void *element)
 {
     for (size_t i = 0; i < vector->length; ++i) {
@@ -76,7 +117,7 @@ void vector_insert_at(vector_t *vector, size_t index, void *element)
 {
     assert(index >= 0);
     assert(index <= vector->length);
-    enlarge_vector_if_full(vector);
+    enlarge_vector(vector, 1);
     ++vector->length;
     memmove(&vector->data[index+1], &vector->data[index],
             sizeof(void*) * (vector->length - index - 1));
@@ -101,4 +142,33 @@ void *vector_remove_at(vector_t *vector, size_t index)
             sizeof(void*) * (vector->length - index - 1));
     --vector->length;
     return element;
-}
\ No newline at end of file
+}
+
+/* Removes 'vector''s element at 'index', replacing it by the last element,
+ * and returns the removed element.  This takes constant time, but it does
+ * not preserve the order of the elements. */
+void *vector_swap_remove_at(vector_t *vector, size_t index)
+{
+    assert(index < vector->length);
+    void *element = vector->data[index];
+    vector->data[index] = vector->data[--vector->length];
+    return element;
+}
+
+/* Removes from 'vector' each element for which 'pred', called with the
+ * element and 'aux', returns true, keeping the remaining elements in order,
+ * and returns the number removed.  Takes a single pass over 'vector', so it
+ * is much faster than calling vector_remove() for each element to remove. */
+size_t vector_remove_if(vector_t *vector,
+                        bool (*pred)(void *element, void *aux), void *aux)
+{
+    size_t i, j;
+
+    for (i = j = 0; i < vector->length; i++) {
+        if (!pred(vector->data[i], aux)) {
+            vector->data[j++] = vector->data[i];
+        }
+    }
+    vector->length = j;
+    return i - j;
+}